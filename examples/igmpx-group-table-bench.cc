@@ -0,0 +1,159 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+/*
+ * Microbenchmark of the IGMPX membership table:
+ * std::map<SourceGroupPair, IgmpState> against SourceGroupTable<IgmpState>,
+ * from 10^3 to maxEntries (S,G) entries.
+ *
+ * For each size it measures the insertion of all the entries,
+ * a number of lookups (half hits, half misses) and the removal of all the entries.
+ * Both tables must report the same number of hits.
+ *
+ * ./waf --run "igmpx-group-table-bench --maxEntries=1000000 --lookups=1000000"
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+
+#include <ns3/core-module.h>
+#include <ns3/system-wall-clock-ms.h>
+#include <ns3/igmpx-routing.h>
+
+using namespace ns3;
+using namespace ns3::igmpx;
+
+NS_LOG_COMPONENT_DEFINE ("IgmpxGroupTableBench");
+
+static uint32_t g_seed = 1;
+
+static uint32_t
+NextRandom ()
+{
+  // Cheap LCG, the benchmark should measure the tables, not the RNG.
+  g_seed = g_seed * 1664525 + 1013904223;
+  return g_seed;
+}
+
+static void
+BuildKeys (uint32_t entries, std::vector<SourceGroupPair> &present, std::vector<SourceGroupPair> &absent)
+{
+  present.clear ();
+  absent.clear ();
+  for (uint32_t i = 0; i < entries; i++)
+    {
+      // Sources in 10.0.0.0/8, groups in 225.0.0.0/8: as many sources as groups,
+      // odd group suffixes are registered, even ones are used for misses.
+      Ipv4Address source (0x0a000000 | (NextRandom () & 0x00ffffff));
+      Ipv4Address group (0xe1000000 | ((2 * i + 1) & 0x00ffffff));
+      present.push_back (SourceGroupPair (source, group));
+      absent.push_back (SourceGroupPair (source, Ipv4Address (0xe1000000 | ((2 * i) & 0x00ffffff))));
+    }
+}
+
+static void
+BenchMap (const std::vector<SourceGroupPair> &present, const std::vector<SourceGroupPair> &absent, uint32_t lookups,
+          int64_t &insert, int64_t &find, int64_t &erase, uint32_t &hits)
+{
+  std::map<SourceGroupPair, IgmpState> table;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < present.size (); i++)
+    {
+      table.insert (std::pair<SourceGroupPair, IgmpState> (present[i], IgmpState (present[i])));
+    }
+  insert = clock.End ();
+  hits = 0;
+  clock.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      const SourceGroupPair &sgp = (i & 1) ? absent[NextRandom () % absent.size ()] : present[NextRandom () % present.size ()];
+      hits += (table.find (sgp) != table.end ());
+    }
+  find = clock.End ();
+  clock.Start ();
+  for (uint32_t i = 0; i < present.size (); i++)
+    {
+      table.erase (present[i]);
+    }
+  erase = clock.End ();
+}
+
+static void
+BenchHash (const std::vector<SourceGroupPair> &present, const std::vector<SourceGroupPair> &absent, uint32_t lookups,
+           int64_t &insert, int64_t &find, int64_t &erase, uint32_t &hits)
+{
+  SourceGroupTable<IgmpState> table;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < present.size (); i++)
+    {
+      table.Insert (PackSourceGroup (present[i]), IgmpState (present[i]));
+    }
+  insert = clock.End ();
+  hits = 0;
+  clock.Start ();
+  for (uint32_t i = 0; i < lookups; i++)
+    {
+      const SourceGroupPair &sgp = (i & 1) ? absent[NextRandom () % absent.size ()] : present[NextRandom () % present.size ()];
+      hits += (table.Find (PackSourceGroup (sgp)) != 0);
+    }
+  find = clock.End ();
+  clock.Start ();
+  for (uint32_t i = 0; i < present.size (); i++)
+    {
+      table.Erase (PackSourceGroup (present[i]));
+    }
+  erase = clock.End ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t maxEntries = 1000000;
+  uint32_t lookups = 1000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("maxEntries", "Largest number of (S,G) entries.", maxEntries);
+  cmd.AddValue ("lookups", "Number of lookups per run.", lookups);
+  cmd.Parse (argc, argv);
+
+  std::cout << std::setw (10) << "entries" << std::setw (8) << "table"
+      << std::setw (12) << "insert(ms)" << std::setw (12) << "find(ms)" << std::setw (12) << "erase(ms)" << std::setw (10) << "hits" << "\n";
+  std::vector<SourceGroupPair> present, absent;
+  for (uint32_t entries = 1000; entries <= maxEntries; entries *= 10)
+    {
+      BuildKeys (entries, present, absent);
+      int64_t insert, find, erase;
+      uint32_t hits;
+      BenchMap (present, absent, lookups, insert, find, erase, hits);
+      std::cout << std::setw (10) << entries << std::setw (8) << "map"
+          << std::setw (12) << insert << std::setw (12) << find << std::setw (12) << erase << std::setw (10) << hits << "\n";
+      BenchHash (present, absent, lookups, insert, find, erase, hits);
+      std::cout << std::setw (10) << entries << std::setw (8) << "hash"
+          << std::setw (12) << insert << std::setw (12) << find << std::setw (12) << erase << std::setw (10) << hits << "\n";
+    }
+  return 0;
+}
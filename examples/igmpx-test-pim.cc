@@ -442,21 +442,13 @@ main (int argc, char *argv[])
 		std::stringstream command;//create a stringstream
 		command<< "NodeList/" << routers.Get(n)->GetId() << "/$ns3::pimdm::MulticastRoutingProtocol/RegisterSG";
 		Config::Set(command.str(), StringValue(ss.str()));
-		command.str("");
-		command<< "NodeList/" << routers.Get(n)->GetId() << "/$ns3::igmpx::IGMPXRoutingProtocol/PeerRole";
-		Config::Set(command.str(), EnumValue(igmpx::ROUTER));
 	}
+	igmpxStack.SetPeerRole(routers, igmpx::ROUTER);
 	// CLIENTS
-	ss.str("");
-	ss<< multicastSource<< "," << multicastGroup << "," << "1";
-	for (uint32_t n = 0;  n < clients.GetN() ; n++){//Clients are RN nodes
-		std::stringstream command;
-		command<< "/NodeList/" << clients.Get(n)->GetId()<<"/$ns3::igmpx::IGMPXRoutingProtocol/PeerRole";
-		Config::Set(command.str(), EnumValue(igmpx::CLIENT));
-		command.str("");
-		command<< "/NodeList/" << clients.Get(n)->GetId()<<"/$ns3::igmpx::IGMPXRoutingProtocol/RegisterAsMember";
-		Config::Set(command.str(), StringValue(ss.str()));
-	}
+	igmpxStack.SetPeerRole(clients, igmpx::CLIENT);
+	std::vector<IgmpxMembership> memberships;
+	memberships.push_back(IgmpxMembership(multicastSource, multicastGroup, 1));
+	igmpxStack.RegisterMembers(clients, memberships);
 
 	if(g_verbose){
 		Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PhyTxDrop",MakeCallback (&PhyTxDrop));
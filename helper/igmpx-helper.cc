@@ -87,4 +87,42 @@ namespace ns3
     m_agentFactory.Set(name, value);
   }
 
+  int64_t
+  IgmpxHelper::AssignStreams (NodeContainer c, int64_t stream)
+  {
+    int64_t currentStream = stream;
+    for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i)
+      {
+        Ptr<igmpx::IGMPXRoutingProtocol> igmpx = (*i)->GetObject<igmpx::IGMPXRoutingProtocol>();
+        NS_ASSERT_MSG(igmpx, "IGMPX not installed on node " << (*i)->GetId());
+        currentStream += igmpx->AssignStreams(currentStream);
+      }
+    return (currentStream - stream);
+  }
+
+  void
+  IgmpxHelper::SetPeerRole (NodeContainer c, igmpx::PeerRole role) const
+  {
+    for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i)
+      {
+        Ptr<igmpx::IGMPXRoutingProtocol> igmpx = (*i)->GetObject<igmpx::IGMPXRoutingProtocol>();
+        NS_ASSERT_MSG(igmpx, "IGMPX not installed on node " << (*i)->GetId());
+        igmpx->SetPeerRole(role);
+      }
+  }
+
+  void
+  IgmpxHelper::RegisterMembers (NodeContainer c, const std::vector<IgmpxMembership> &memberships) const
+  {
+    for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i)
+      {
+        Ptr<igmpx::IGMPXRoutingProtocol> igmpx = (*i)->GetObject<igmpx::IGMPXRoutingProtocol>();
+        NS_ASSERT_MSG(igmpx, "IGMPX not installed on node " << (*i)->GetId());
+        for (std::vector<IgmpxMembership>::const_iterator m = memberships.begin(); m != memberships.end(); ++m)
+          {
+            igmpx->RegisterInterface(m->source, m->group, m->interface);
+          }
+      }
+  }
+
 } // namespace ns3
@@ -31,9 +31,24 @@
 #include <ns3/igmpx-routing.h>
 #include <map>
 #include <set>
+#include <vector>
 
 namespace ns3
 {
+  /**
+   * \brief Source-Group-Interface tuple to register on a client, see IgmpxHelper::RegisterMembers.
+   */
+  struct IgmpxMembership
+  {
+      IgmpxMembership (Ipv4Address s, Ipv4Address g, uint32_t i) :
+          source (s), group (g), interface (i)
+      {
+      }
+      Ipv4Address source; ///< Multicast source, ANY for all the sources of the group.
+      Ipv4Address group; ///< Multicast group.
+      uint32_t interface; ///< Client interface.
+  };
+
   /**
    * \brief Helper class for IGMP-like protocol.
    */
@@ -86,6 +101,37 @@ namespace ns3
       void
       Set (std::string name, const AttributeValue &value);
 
+      /**
+       * \param c NodeContainer of the nodes running the IGMP-like protocol.
+       * \param stream First stream index to use.
+       * \returns Number of stream indices assigned by this helper.
+       *
+       * Assign fixed random variable streams to the protocol of each node, in the container order.
+       */
+      int64_t
+      AssignStreams (NodeContainer c, int64_t stream);
+
+      /**
+       * \param c NodeContainer of the nodes running the IGMP-like protocol.
+       * \param role Role of the nodes.
+       *
+       * Set the role of the protocol installed on each node,
+       * like the PeerRole attribute but without resolving a Config path per node.
+       */
+      void
+      SetPeerRole (NodeContainer c, igmpx::PeerRole role) const;
+
+      /**
+       * \param c NodeContainer of the client nodes.
+       * \param memberships Source-Group-Interface tuples to register on each node.
+       *
+       * Register the tuples on the protocol installed on each node,
+       * like the RegisterAsMember attribute but without parsing a string per tuple.
+       * The nodes must already have the CLIENT role.
+       */
+      void
+      RegisterMembers (NodeContainer c, const std::vector<IgmpxMembership> &memberships) const;
+
     private:
       /**
        * \internal
@@ -0,0 +1,804 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+#ifndef __IGMPX_GROUP_TABLE_H__
+#define __IGMPX_GROUP_TABLE_H__
+
+#include <ns3/assert.h>
+#include <ns3/ipv4-address.h>
+#include <ns3/nstime.h>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+namespace ns3
+{
+  namespace igmpx
+  {
+    /**
+     *
+     * \param source Multicast source address.
+     * \param group Multicast group address.
+     * \returns The (source, group) pair packed in 64 bits, group in the upper half.
+     *
+     */
+    static inline uint64_t
+    PackSourceGroup (Ipv4Address source, Ipv4Address group)
+    {
+      return (static_cast<uint64_t> (group.Get ()) << 32) | source.Get ();
+    }
+
+    /**
+     * \brief Flat open-addressing hash table keyed on a packed (source, group) pair.
+     *
+     * Keys are looked up with linear probing in a power-of-two slot array,
+     * kept at most half full; deletions use backward shifting, so no tombstones.
+     * Values are allocated once when inserted and never move:
+     * a pointer returned by Find or Insert stays valid until its entry is erased.
+     *
+     * Entries are also kept in a dense array for iteration, see Get.
+     * Erase moves the last entry into the erased position,
+     * hence loops that erase must not advance the index after an erase.
+     */
+    template <typename T>
+    class SourceGroupTable
+    {
+      public:
+        SourceGroupTable ();
+        ~SourceGroupTable ();
+
+        /**
+         * \param key Packed (source, group) pair.
+         * \returns The value stored for the key, 0 if missing.
+         */
+        T*
+        Find (uint64_t key) const;
+
+        /**
+         * \param key Packed (source, group) pair.
+         * \param value Value to copy into the table.
+         * \returns The value stored for the key: the existing one, if any, otherwise the new copy.
+         */
+        T*
+        Insert (uint64_t key, const T &value);
+
+        /**
+         * \param key Packed (source, group) pair.
+         * \returns True if the key was in the table.
+         */
+        bool
+        Erase (uint64_t key);
+
+        void
+        Clear ();
+
+        uint32_t
+        Size () const;
+
+        bool
+        Empty () const;
+
+        /**
+         * \param i Index in [0, Size ()).
+         * \returns The i-th value in the dense array.
+         */
+        T*
+        Get (uint32_t i) const;
+
+        /**
+         * \param i Index in [0, Size ()).
+         * \returns The key of the i-th value in the dense array.
+         */
+        uint64_t
+        GetKey (uint32_t i) const;
+
+      private:
+        /// Copy and assignment are not allowed, the table owns its values.
+        SourceGroupTable (const SourceGroupTable &o);
+        SourceGroupTable &
+        operator = (const SourceGroupTable &o);
+
+        struct Slot
+        {
+          uint64_t key;
+          uint32_t index; ///< Position in the dense array, EMPTY if the slot is free.
+        };
+
+        static const uint32_t EMPTY = 0xffffffff;
+        static const uint32_t MIN_SLOTS = 16;
+
+        static uint32_t
+        Hash (uint64_t key);
+
+        /// \returns The slot holding the key, or EMPTY.
+        uint32_t
+        Lookup (uint64_t key) const;
+
+        void
+        Resize (uint32_t slots);
+
+        std::vector<Slot> m_slots; ///< Open-addressing index.
+        uint32_t m_mask; ///< Number of slots minus one.
+        std::vector<std::pair<uint64_t, T*> > m_entries; ///< Dense array of <key, value>.
+    };
+
+    template <typename T>
+    SourceGroupTable<T>::SourceGroupTable () :
+        m_mask (0)
+    {
+      Resize (MIN_SLOTS);
+    }
+
+    template <typename T>
+    SourceGroupTable<T>::~SourceGroupTable ()
+    {
+      Clear ();
+    }
+
+    template <typename T>
+    inline uint32_t
+    SourceGroupTable<T>::Hash (uint64_t key)
+    {
+      // Fibonacci hashing: the upper bits of the product mix both addresses.
+      return static_cast<uint32_t> ((key * 0x9e3779b97f4a7c15ULL) >> 32);
+    }
+
+    template <typename T>
+    inline uint32_t
+    SourceGroupTable<T>::Lookup (uint64_t key) const
+    {
+      for (uint32_t s = Hash (key) & m_mask;; s = (s + 1) & m_mask)
+        {
+          if (m_slots[s].index == EMPTY)
+            return EMPTY;
+          if (m_slots[s].key == key)
+            return s;
+        }
+    }
+
+    template <typename T>
+    inline T*
+    SourceGroupTable<T>::Find (uint64_t key) const
+    {
+      uint32_t s = Lookup (key);
+      return (s == EMPTY ? 0 : m_entries[m_slots[s].index].second);
+    }
+
+    template <typename T>
+    T*
+    SourceGroupTable<T>::Insert (uint64_t key, const T &value)
+    {
+      uint32_t s = Hash (key) & m_mask;
+      for (; m_slots[s].index != EMPTY; s = (s + 1) & m_mask)
+        {
+          if (m_slots[s].key == key)
+            return m_entries[m_slots[s].index].second;
+        }
+      T *entry = new T (value);
+      m_slots[s].key = key;
+      m_slots[s].index = m_entries.size ();
+      m_entries.push_back (std::make_pair (key, entry));
+      if (2 * m_entries.size () > m_mask + 1)
+        {
+          Resize (2 * (m_mask + 1));
+        }
+      return entry;
+    }
+
+    template <typename T>
+    bool
+    SourceGroupTable<T>::Erase (uint64_t key)
+    {
+      uint32_t s = Lookup (key);
+      if (s == EMPTY)
+        return false;
+      uint32_t index = m_slots[s].index;
+      delete m_entries[index].second;
+      // Fill the hole in the dense array with the last entry.
+      uint32_t last = m_entries.size () - 1;
+      if (index != last)
+        {
+          m_entries[index] = m_entries[last];
+          m_slots[Lookup (m_entries[index].first)].index = index;
+        }
+      m_entries.pop_back ();
+      // Shift back the entries following the freed slot in the probe sequence.
+      uint32_t hole = s;
+      for (uint32_t next = (hole + 1) & m_mask; m_slots[next].index != EMPTY; next = (next + 1) & m_mask)
+        {
+          uint32_t home = Hash (m_slots[next].key) & m_mask;
+          // Move the entry unless its home lies cyclically in (hole, next].
+          if (((next - home) & m_mask) >= ((next - hole) & m_mask))
+            {
+              m_slots[hole] = m_slots[next];
+              hole = next;
+            }
+        }
+      m_slots[hole].index = EMPTY;
+      return true;
+    }
+
+    template <typename T>
+    void
+    SourceGroupTable<T>::Clear ()
+    {
+      for (typename std::vector<std::pair<uint64_t, T*> >::iterator iter = m_entries.begin ();
+          iter != m_entries.end (); iter++)
+        {
+          delete iter->second;
+        }
+      m_entries.clear ();
+      Resize (MIN_SLOTS);
+    }
+
+    template <typename T>
+    inline uint32_t
+    SourceGroupTable<T>::Size () const
+    {
+      return m_entries.size ();
+    }
+
+    template <typename T>
+    inline bool
+    SourceGroupTable<T>::Empty () const
+    {
+      return m_entries.empty ();
+    }
+
+    template <typename T>
+    inline T*
+    SourceGroupTable<T>::Get (uint32_t i) const
+    {
+      NS_ASSERT (i < m_entries.size ());
+      return m_entries[i].second;
+    }
+
+    template <typename T>
+    inline uint64_t
+    SourceGroupTable<T>::GetKey (uint32_t i) const
+    {
+      NS_ASSERT (i < m_entries.size ());
+      return m_entries[i].first;
+    }
+
+    template <typename T>
+    void
+    SourceGroupTable<T>::Resize (uint32_t slots)
+    {
+      NS_ASSERT ((slots & (slots - 1)) == 0);
+      Slot empty;
+      empty.key = 0;
+      empty.index = EMPTY;
+      m_slots.assign (slots, empty);
+      m_mask = slots - 1;
+      for (uint32_t i = 0; i < m_entries.size (); i++)
+        {
+          uint32_t s = Hash (m_entries[i].first) & m_mask;
+          while (m_slots[s].index != EMPTY)
+            {
+              s = (s + 1) & m_mask;
+            }
+          m_slots[s].key = m_entries[i].first;
+          m_slots[s].index = i;
+        }
+    }
+
+    /**
+     * \brief Flat open-addressing hash map from a local address to its interface index.
+     *
+     * Same probing and backward-shift deletion as SourceGroupTable, with the
+     * interface index stored in the slot: lookups allocate and copy nothing.
+     */
+    class AddressTable
+    {
+      public:
+        AddressTable ()
+        {
+          Clear ();
+        }
+
+        /**
+         * \param address Local address.
+         * \param interface Interface index of the address, replacing the previous one if any.
+         */
+        void
+        Insert (Ipv4Address address, uint32_t interface)
+        {
+          NS_ASSERT (interface != EMPTY);
+          uint32_t s = Hash (address.Get ()) & m_mask;
+          for (; m_slots[s].interface != EMPTY; s = (s + 1) & m_mask)
+            {
+              if (m_slots[s].address == address.Get ())
+                {
+                  m_slots[s].interface = interface;
+                  return;
+                }
+            }
+          m_slots[s].address = address.Get ();
+          m_slots[s].interface = interface;
+          if (2 * ++m_size > m_mask + 1)
+            Resize (2 * (m_mask + 1));
+        }
+
+        /**
+         * \param address Local address.
+         * \returns True if the address was in the table.
+         */
+        bool
+        Erase (Ipv4Address address)
+        {
+          uint32_t s = Lookup (address.Get ());
+          if (s == EMPTY)
+            return false;
+          uint32_t hole = s;
+          for (uint32_t next = (hole + 1) & m_mask; m_slots[next].interface != EMPTY; next = (next + 1) & m_mask)
+            {
+              uint32_t home = Hash (m_slots[next].address) & m_mask;
+              // Move the entry unless its home lies cyclically in (hole, next].
+              if (((next - home) & m_mask) >= ((next - hole) & m_mask))
+                {
+                  m_slots[hole] = m_slots[next];
+                  hole = next;
+                }
+            }
+          m_slots[hole].interface = EMPTY;
+          m_size--;
+          return true;
+        }
+
+        /**
+         * \param address Address to look for.
+         * \param interface Set to the interface index of the address, if found.
+         * \returns True if the address is in the table.
+         */
+        bool
+        Find (Ipv4Address address, uint32_t &interface) const
+        {
+          uint32_t s = Lookup (address.Get ());
+          if (s == EMPTY)
+            return false;
+          interface = m_slots[s].interface;
+          return true;
+        }
+
+        /// \returns True if the address is in the table.
+        bool
+        Contains (Ipv4Address address) const
+        {
+          return Lookup (address.Get ()) != EMPTY;
+        }
+
+        uint32_t
+        Size () const
+        {
+          return m_size;
+        }
+
+        void
+        Clear ()
+        {
+          m_slots.clear ();
+          m_size = 0;
+          Resize (MIN_SLOTS);
+        }
+
+      private:
+        struct Slot
+        {
+          uint32_t address;
+          uint32_t interface; ///< EMPTY if the slot is free.
+        };
+
+        static const uint32_t EMPTY = 0xffffffff;
+        static const uint32_t MIN_SLOTS = 16;
+
+        static uint32_t
+        Hash (uint32_t address)
+        {
+          // Fibonacci hashing: the upper bits of the product mix the whole address.
+          return static_cast<uint32_t> ((address * 0x9e3779b97f4a7c15ULL) >> 32);
+        }
+
+        uint32_t
+        Lookup (uint32_t address) const
+        {
+          for (uint32_t s = Hash (address) & m_mask;; s = (s + 1) & m_mask)
+            {
+              if (m_slots[s].interface == EMPTY)
+                return EMPTY;
+              if (m_slots[s].address == address)
+                return s;
+            }
+        }
+
+        void
+        Resize (uint32_t slots)
+        {
+          std::vector<Slot> old;
+          old.swap (m_slots);
+          Slot empty;
+          empty.address = 0;
+          empty.interface = EMPTY;
+          m_slots.assign (slots, empty);
+          m_mask = slots - 1;
+          for (std::vector<Slot>::const_iterator iter = old.begin (); iter != old.end (); iter++)
+            {
+              if (iter->interface == EMPTY)
+                continue;
+              uint32_t s = Hash (iter->address) & m_mask;
+              while (m_slots[s].interface != EMPTY)
+                {
+                  s = (s + 1) & m_mask;
+                }
+              m_slots[s] = *iter;
+            }
+        }
+
+        std::vector<Slot> m_slots; ///< Open-addressing index.
+        uint32_t m_mask; ///< Number of slots minus one.
+        uint32_t m_size; ///< Number of addresses.
+    };
+
+    /**
+     * \brief Bloom filter on multicast group addresses.
+     *
+     * A compact pre-filter on the groups of the membership table:
+     * MayContain never misses an inserted group, and rarely reports a group never inserted.
+     * Entries cannot be removed, the filter is rebuilt with Clear and Insert.
+     */
+    class GroupFilter
+    {
+      public:
+        GroupFilter ()
+        {
+          Clear ();
+        }
+
+        void
+        Insert (Ipv4Address group)
+        {
+          uint64_t h = Hash (group);
+          Set (h >> 54);
+          Set ((h >> 44) & MASK);
+        }
+
+        /// \returns False if the group was never inserted, true if it might have been.
+        bool
+        MayContain (Ipv4Address group) const
+        {
+          uint64_t h = Hash (group);
+          return Test (h >> 54) && Test ((h >> 44) & MASK);
+        }
+
+        void
+        Clear ()
+        {
+          for (uint32_t i = 0; i < WORDS; i++)
+            m_bits[i] = 0;
+        }
+
+      private:
+        static const uint32_t WORDS = 16; ///< 1024 bits.
+        static const uint32_t MASK = WORDS * 64 - 1;
+
+        /// Fibonacci hashing: the two bit positions are taken from the upper, well mixed bits.
+        static uint64_t
+        Hash (Ipv4Address group)
+        {
+          return static_cast<uint64_t> (group.Get ()) * 0x9e3779b97f4a7c15ULL;
+        }
+
+        void
+        Set (uint64_t bit)
+        {
+          m_bits[bit >> 6] |= static_cast<uint64_t> (1) << (bit & 63);
+        }
+
+        bool
+        Test (uint64_t bit) const
+        {
+          return (m_bits[bit >> 6] >> (bit & 63)) & 1;
+        }
+
+        uint64_t m_bits[WORDS];
+    };
+
+    /**
+     * \brief Clients of a Source-Group pair on an interface, with the time each one was last heard.
+     *
+     * A vector sorted by address: an interface has few clients, so a binary search
+     * and a shift on insert are cheaper than a tree, and the entries stay contiguous.
+     */
+    class ClientSet
+    {
+      public:
+        /**
+         * \param client Client heard.
+         * \param now Time it was heard.
+         * \returns True if the client is new.
+         */
+        bool
+        Refresh (Ipv4Address client, Time now)
+        {
+          std::vector<Entry>::iterator iter = std::lower_bound (m_entries.begin (), m_entries.end (), client, Less);
+          if (iter != m_entries.end () && iter->address == client)
+            {
+              iter->lastSeen = now;
+              return false;
+            }
+          Entry entry;
+          entry.address = client;
+          entry.lastSeen = now;
+          m_entries.insert (iter, entry);
+          return true;
+        }
+
+        /// \returns True if the client was in the set.
+        bool
+        Remove (Ipv4Address client)
+        {
+          std::vector<Entry>::iterator iter = std::lower_bound (m_entries.begin (), m_entries.end (), client, Less);
+          if (iter == m_entries.end () || iter->address != client)
+            return false;
+          m_entries.erase (iter);
+          return true;
+        }
+
+        /**
+         * \param deadline Oldest time a client must have been heard to stay.
+         * \returns The number of clients removed.
+         */
+        uint32_t
+        Expire (Time deadline)
+        {
+          uint32_t kept = 0;
+          for (uint32_t i = 0; i < m_entries.size (); i++)
+            {
+              if (m_entries[i].lastSeen >= deadline)
+                m_entries[kept++] = m_entries[i];
+            }
+          uint32_t removed = m_entries.size () - kept;
+          m_entries.resize (kept);
+          return removed;
+        }
+
+        bool
+        Contains (Ipv4Address client) const
+        {
+          std::vector<Entry>::const_iterator iter = std::lower_bound (m_entries.begin (), m_entries.end (), client, Less);
+          return iter != m_entries.end () && iter->address == client;
+        }
+
+        uint32_t
+        Size () const
+        {
+          return m_entries.size ();
+        }
+
+        bool
+        Empty () const
+        {
+          return m_entries.empty ();
+        }
+
+        /// \returns The i-th client, in address order.
+        Ipv4Address
+        GetClient (uint32_t i) const
+        {
+          NS_ASSERT (i < m_entries.size ());
+          return m_entries[i].address;
+        }
+
+        /// \returns When the i-th client was last heard.
+        Time
+        GetLastSeen (uint32_t i) const
+        {
+          NS_ASSERT (i < m_entries.size ());
+          return m_entries[i].lastSeen;
+        }
+
+        void
+        Clear ()
+        {
+          m_entries.clear ();
+        }
+
+      private:
+        struct Entry
+        {
+          Ipv4Address address;
+          Time lastSeen;
+        };
+
+        static bool
+        Less (const Entry &entry, Ipv4Address address)
+        {
+          return entry.address < address;
+        }
+
+        std::vector<Entry> m_entries;
+    };
+
+    /**
+     * \brief PIM-DM memberships of a router, out of its (S,G) and any-source (*,G) entries.
+     *
+     * PIM-DM keeps per-source state: a (*,G) entry on an interface stands for every source of G known,
+     * including the sources learned after it joined. Each (S,G) membership of an interface counts
+     * the entries asking for it, the (S,G) one and the (*,G) one: only the first one in and
+     * the last one out are reported as changes, to be passed to PIM-DM.
+     */
+    class PimMembership
+    {
+      public:
+        /// Membership of a Source-Group pair on an interface that changed.
+        struct Change
+        {
+          Change (Ipv4Address s, Ipv4Address g, uint32_t i, bool m) :
+              source (s), group (g), interface (i), member (m)
+          {
+          }
+          Ipv4Address source;
+          Ipv4Address group;
+          uint32_t interface;
+          bool member; ///< True if the interface joined the pair, false if it left it.
+        };
+
+        /**
+         * \param source Multicast source, ANY for any source.
+         * \param group Multicast group.
+         * \param interface Interface that gained its first client of the entry.
+         * \param changes Memberships that changed, appended.
+         */
+        void
+        Join (Ipv4Address source, Ipv4Address group, uint32_t interface, std::vector<Change> &changes)
+        {
+          Update (source, group, interface, true, changes);
+        }
+
+        /**
+         * \param source Multicast source, ANY for any source.
+         * \param group Multicast group.
+         * \param interface Interface that lost the last client of the entry.
+         * \param changes Memberships that changed, appended.
+         */
+        void
+        Leave (Ipv4Address source, Ipv4Address group, uint32_t interface, std::vector<Change> &changes)
+        {
+          Update (source, group, interface, false, changes);
+        }
+
+        /**
+         * \param source Source of the group.
+         * \param group Multicast group.
+         * \param changes Memberships that changed, appended: the (*,G) interfaces join the new source.
+         * \returns False if the source was already known. Sources are never forgotten.
+         */
+        bool
+        AddSource (Ipv4Address source, Ipv4Address group, std::vector<Change> &changes)
+        {
+          NS_ASSERT (source != Ipv4Address::GetAny ());
+          if (!m_groupSources[group].insert (source).second)
+            return false;
+          std::map<Ipv4Address, std::set<uint32_t> >::const_iterator any = m_anySource.find (group);
+          if (any == m_anySource.end ())
+            return true;
+          for (std::set<uint32_t>::const_iterator iter = any->second.begin (); iter != any->second.end (); iter++)
+            {
+              Count (source, group, *iter, true, changes);
+            }
+          return true;
+        }
+
+        /// \returns True if the source of the group is known.
+        bool
+        IsSourceKnown (Ipv4Address source, Ipv4Address group) const
+        {
+          std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator sources = m_groupSources.find (group);
+          return sources != m_groupSources.end () && sources->second.find (source) != sources->second.end ();
+        }
+
+        /// \returns True if the interface is a PIM-DM member of the Source-Group pair.
+        bool
+        IsMember (Ipv4Address source, Ipv4Address group, uint32_t interface) const
+        {
+          return m_members.find (Key (source, group, interface)) != m_members.end ();
+        }
+
+        void
+        Clear ()
+        {
+          m_groupSources.clear ();
+          m_anySource.clear ();
+          m_members.clear ();
+        }
+
+      private:
+        typedef std::pair<std::pair<Ipv4Address, Ipv4Address>, uint32_t> MemberKey;
+
+        static MemberKey
+        Key (Ipv4Address source, Ipv4Address group, uint32_t interface)
+        {
+          return MemberKey (std::make_pair (source, group), interface);
+        }
+
+        void
+        Update (Ipv4Address source, Ipv4Address group, uint32_t interface, bool member, std::vector<Change> &changes)
+        {
+          if (source != Ipv4Address::GetAny ())
+            {
+              Count (source, group, interface, member, changes);
+              return;
+            }
+          if (member)
+            {
+              if (!m_anySource[group].insert (interface).second)
+                return;
+            }
+          else
+            {
+              std::map<Ipv4Address, std::set<uint32_t> >::iterator any = m_anySource.find (group);
+              if (any == m_anySource.end () || any->second.erase (interface) == 0)
+                return;
+              if (any->second.empty ())
+                m_anySource.erase (any);
+            }
+          std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator sources = m_groupSources.find (group);
+          if (sources == m_groupSources.end ())
+            return;
+          for (std::set<Ipv4Address>::const_iterator iter = sources->second.begin (); iter != sources->second.end (); iter++)
+            {
+              Count (*iter, group, interface, member, changes);
+            }
+        }
+
+        void
+        Count (Ipv4Address source, Ipv4Address group, uint32_t interface, bool member, std::vector<Change> &changes)
+        {
+          MemberKey key = Key (source, group, interface);
+          if (member)
+            {
+              if (m_members[key]++ == 0)
+                changes.push_back (Change (source, group, interface, true));
+              return;
+            }
+          std::map<MemberKey, uint32_t>::iterator count = m_members.find (key);
+          NS_ASSERT (count != m_members.end () && count->second > 0);
+          if (--count->second == 0)
+            {
+              m_members.erase (count);
+              changes.push_back (Change (source, group, interface, false));
+            }
+        }
+
+        std::map<Ipv4Address, std::set<Ipv4Address> > m_groupSources; ///< Group -> sources known.
+        std::map<Ipv4Address, std::set<uint32_t> > m_anySource; ///< Group -> interfaces with a (*,G) entry.
+        std::map<MemberKey, uint32_t> m_members; ///< (S,G) and interface -> entries asking PIM-DM for it.
+    };
+
+  } // namespace igmpx
+} // namespace ns3
+
+#endif
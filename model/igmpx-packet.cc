@@ -85,6 +85,18 @@ namespace ns3
         case IGMPX_ACCEPT:
           size += m_igmpx_message.igmpAccept.GetSerializedSize();
           break;
+        case IGMPX_REPORT_MULTI:
+          size += m_igmpx_message.igmpMultiReport.GetSerializedSize();
+          break;
+        case IGMPX_ACCEPT_MULTI:
+          size += m_igmpx_message.igmpMultiAccept.GetSerializedSize();
+          break;
+        case IGMPX_LEAVE:
+          size += m_igmpx_message.igmpLeave.GetSerializedSize();
+          break;
+        case IGMPX_QUERY:
+          size += m_igmpx_message.igmpQuery.GetSerializedSize();
+          break;
         default:
           {
             NS_ASSERT(false);
@@ -115,6 +127,18 @@ namespace ns3
         case IGMPX_ACCEPT:
           m_igmpx_message.igmpAccept.Serialize(i);
           break;
+        case IGMPX_REPORT_MULTI:
+          m_igmpx_message.igmpMultiReport.Serialize(i);
+          break;
+        case IGMPX_ACCEPT_MULTI:
+          m_igmpx_message.igmpMultiAccept.Serialize(i);
+          break;
+        case IGMPX_LEAVE:
+          m_igmpx_message.igmpLeave.Serialize(i);
+          break;
+        case IGMPX_QUERY:
+          m_igmpx_message.igmpQuery.Serialize(i);
+          break;
         default:
           {
             NS_ASSERT(false);
@@ -141,7 +165,7 @@ namespace ns3
       m_reserved = i.ReadU8();
       m_checksum = i.ReadNtohU16();
       size += 4;
-      NS_ASSERT(m_type >= IGMPX_REPORT && m_type<=IGMPX_ACCEPT);
+      NS_ASSERT(m_type >= IGMPX_REPORT && m_type<=IGMPX_QUERY);
       switch (m_type)
         {
         case IGMPX_REPORT:
@@ -152,6 +176,30 @@ namespace ns3
           message_size += m_igmpx_message.igmpAccept.GetSerializedSize();
           size += m_igmpx_message.igmpAccept.Deserialize(i, message_size - size);
           break;
+        case IGMPX_REPORT_MULTI:
+          {
+            Buffer::Iterator peek = i;
+            uint16_t records = peek.ReadNtohU16();
+            message_size += 4 + records * IGMPX_RECORD_SIZE;
+            size += m_igmpx_message.igmpMultiReport.Deserialize(i, message_size - size);
+            break;
+          }
+        case IGMPX_ACCEPT_MULTI:
+          {
+            Buffer::Iterator peek = i;
+            uint16_t downstreams = peek.ReadNtohU16();
+            message_size += 4 + 2 * IPV4_ADDRESS_SIZE + downstreams * IPV4_ADDRESS_SIZE;
+            size += m_igmpx_message.igmpMultiAccept.Deserialize(i, message_size - size);
+            break;
+          }
+        case IGMPX_LEAVE:
+          message_size += m_igmpx_message.igmpLeave.GetSerializedSize();
+          size += m_igmpx_message.igmpLeave.Deserialize(i, message_size - size);
+          break;
+        case IGMPX_QUERY:
+          message_size += m_igmpx_message.igmpQuery.GetSerializedSize();
+          size += m_igmpx_message.igmpQuery.Deserialize(i, message_size - size);
+          break;
         default:
           {
             NS_ASSERT(false);
@@ -241,5 +289,152 @@ namespace ns3
       return size;
     }
 
+    uint32_t
+    IGMPXHeader::IgmpMultiReportMessage::GetSerializedSize(void) const
+    {
+      return 4 + m_records.size() * IGMPX_RECORD_SIZE;
+    }
+
+    void
+    IGMPXHeader::IgmpMultiReportMessage::Print(std::ostream &os) const
+    {
+      os << " Records = " << m_records.size() << "\n";
+      for (std::vector<IgmpReportMessage>::const_iterator iter = m_records.begin(); iter != m_records.end(); iter++)
+        {
+          iter->Print(os);
+        }
+    }
+
+    void
+    IGMPXHeader::IgmpMultiReportMessage::Serialize(Buffer::Iterator start) const
+    {
+      Buffer::Iterator i = start;
+      NS_ASSERT(m_records.size() <= IGMPX_MAX_RECORDS);
+      i.WriteHtonU16(m_records.size());
+      i.WriteHtonU16(0);
+      for (std::vector<IgmpReportMessage>::const_iterator iter = m_records.begin(); iter != m_records.end(); iter++)
+        {
+          iter->Serialize(i);
+          i.Next(iter->GetSerializedSize());
+        }
+    }
+
+    uint32_t
+    IGMPXHeader::IgmpMultiReportMessage::Deserialize(Buffer::Iterator start,
+        uint32_t messageSize)
+    {
+      Buffer::Iterator i = start;
+      uint32_t size;
+      uint16_t records = i.ReadNtohU16();
+      i.ReadNtohU16();
+      size = 4;
+      NS_ASSERT(messageSize == 4 + records * IGMPX_RECORD_SIZE);
+      m_records.clear();
+      m_records.reserve(records);
+      for (uint16_t r = 0; r < records; r++)
+        {
+          IgmpReportMessage record;
+          uint32_t recordSize = record.Deserialize(i, IGMPX_RECORD_SIZE);
+          i.Next(recordSize);
+          size += recordSize;
+          m_records.push_back(record);
+        }
+      return size;
+    }
+
+    uint32_t
+    IGMPXHeader::IgmpMultiAcceptMessage::GetSerializedSize(void) const
+    {
+      return 4 + 2 * IPV4_ADDRESS_SIZE + m_downstreamAddrs.size() * IPV4_ADDRESS_SIZE;
+    }
+
+    void
+    IGMPXHeader::IgmpMultiAcceptMessage::Print(std::ostream &os) const
+    {
+      os << " Group = " << m_multicastGroupAddr << " Source = " << m_sourceAddr
+          << " Downstreams = " << m_downstreamAddrs.size() << "\n";
+      for (std::vector<Ipv4Address>::const_iterator iter = m_downstreamAddrs.begin(); iter != m_downstreamAddrs.end(); iter++)
+        {
+          os << "  Downstream = " << *iter << "\n";
+        }
+    }
+
+    void
+    IGMPXHeader::IgmpMultiAcceptMessage::Serialize(Buffer::Iterator start) const
+    {
+      Buffer::Iterator i = start;
+      NS_ASSERT(m_downstreamAddrs.size() <= IGMPX_MAX_RECORDS);
+      i.WriteHtonU16(m_downstreamAddrs.size());
+      i.WriteHtonU16(0);
+      i.WriteHtonU32(m_multicastGroupAddr.Get());
+      i.WriteHtonU32(m_sourceAddr.Get());
+      for (std::vector<Ipv4Address>::const_iterator iter = m_downstreamAddrs.begin(); iter != m_downstreamAddrs.end(); iter++)
+        {
+          i.WriteHtonU32(iter->Get());
+        }
+    }
+
+    uint32_t
+    IGMPXHeader::IgmpMultiAcceptMessage::Deserialize(Buffer::Iterator start,
+        uint32_t messageSize)
+    {
+      Buffer::Iterator i = start;
+      uint32_t size;
+      uint16_t downstreams = i.ReadNtohU16();
+      i.ReadNtohU16();
+      size = 4;
+      NS_ASSERT(messageSize == 4 + 2 * IPV4_ADDRESS_SIZE + downstreams * IPV4_ADDRESS_SIZE);
+      m_multicastGroupAddr = Ipv4Address(i.ReadNtohU32());
+      size += 4;
+      m_sourceAddr = Ipv4Address(i.ReadNtohU32());
+      size += 4;
+      m_downstreamAddrs.clear();
+      m_downstreamAddrs.reserve(downstreams);
+      for (uint16_t d = 0; d < downstreams; d++)
+        {
+          m_downstreamAddrs.push_back(Ipv4Address(i.ReadNtohU32()));
+          size += 4;
+        }
+      return size;
+    }
+
+    uint32_t
+    IGMPXHeader::IgmpQueryMessage::GetSerializedSize(void) const
+    {
+      return 12;
+    }
+
+    void
+    IGMPXHeader::IgmpQueryMessage::Print(std::ostream &os) const
+    {
+      os << " Group = " << m_multicastGroupAddr << " Source = " << m_sourceAddr
+          << " Max Response Time = " << m_maxResponseTime << "ms\n";
+    }
+
+    void
+    IGMPXHeader::IgmpQueryMessage::Serialize(Buffer::Iterator start) const
+    {
+      Buffer::Iterator i = start;
+      i.WriteHtonU32(m_multicastGroupAddr.Get());
+      i.WriteHtonU32(m_sourceAddr.Get());
+      i.WriteHtonU32(m_maxResponseTime);
+    }
+
+    uint32_t
+    IGMPXHeader::IgmpQueryMessage::Deserialize(Buffer::Iterator start,
+        uint32_t messageSize)
+    {
+      Buffer::Iterator i = start;
+      NS_ASSERT(messageSize == this->GetSerializedSize());
+      uint32_t size;
+      m_multicastGroupAddr = Ipv4Address(i.ReadNtohU32());
+      size = 4;
+      m_sourceAddr = Ipv4Address(i.ReadNtohU32());
+      size += 4;
+      m_maxResponseTime = i.ReadNtohU32();
+      size += 4;
+      return size;
+    }
+
   } // namespace igmpx
 } // namespace ns3
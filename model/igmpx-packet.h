@@ -42,10 +42,15 @@ namespace ns3
     const uint32_t IGMPX_IP_PROTOCOL_NUM = 104;
     const uint32_t IGMPX_PORT_NUM = 905;
     const std::string ALL_IGMPX_NODES("224.2.2.1");
+    /// Size of a single (group, source, node) record.
+    const uint32_t IGMPX_RECORD_SIZE = 3 * IPV4_ADDRESS_SIZE;
+    /// Maximum number of records carried by a multi-record message.
+    const uint32_t IGMPX_MAX_RECORDS = 100;
 
     enum IGMPXType
     {
-      IGMPX_REPORT = 11, IGMPX_ACCEPT = 12
+      IGMPX_REPORT = 11, IGMPX_ACCEPT = 12, IGMPX_REPORT_MULTI = 13, IGMPX_ACCEPT_MULTI = 14,
+      IGMPX_LEAVE = 15, IGMPX_QUERY = 16
     };
 
     /**
@@ -151,11 +156,116 @@ namespace ns3
         uint32_t Deserialize(Buffer::Iterator start, uint32_t messageSize);
       };
 
+//	0               1               2               3
+//	0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|      Number of records        |           Reserved            |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|               Multicast group address [1]                     |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Unicast source address [1]                     |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Upstream node address [1]                      |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                             ...                               |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|               Multicast group address [N]                     |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Unicast source address [N]                     |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Upstream node address [N]                      |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//
+
+      /**
+       * A report carrying several (group, source, upstream) records,
+       * used by the clients to send all the reports due on an interface in one packet.
+       */
+      struct IgmpMultiReportMessage
+      {
+        std::vector<IgmpReportMessage> m_records;
+
+        void Print(std::ostream &os) const;
+        uint32_t GetSerializedSize(void) const;
+        void Serialize(Buffer::Iterator start) const;
+        uint32_t Deserialize(Buffer::Iterator start, uint32_t messageSize);
+      };
+
+//	0               1               2               3
+//	0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|    Number of downstreams      |           Reserved            |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|               Multicast group address                         |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Unicast source address                         |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|              Downstream node address [1]                      |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                             ...                               |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|              Downstream node address [N]                      |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//
+
+      /**
+       * An accept for one (group, source) pair listing several downstream clients,
+       * used by the routers to answer all the clients heard on an interface in one packet.
+       */
+      struct IgmpMultiAcceptMessage
+      {
+        Ipv4Address m_multicastGroupAddr;
+        Ipv4Address m_sourceAddr;
+        std::vector<Ipv4Address> m_downstreamAddrs;
+
+        void Print(std::ostream &os) const;
+        uint32_t GetSerializedSize(void) const;
+        void Serialize(Buffer::Iterator start) const;
+        uint32_t Deserialize(Buffer::Iterator start, uint32_t messageSize);
+      };
+
+      /**
+       * A client leaving a (group, source) pair on the link, sent to its upstream router.
+       * Same format as the report.
+       */
+      typedef IgmpReportMessage IgmpLeaveMessage;
+
+//	0               1               2               3
+//	0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|               Multicast group address                         |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Unicast source address                         |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//	|                Maximum response time (ms)                     |
+//	+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//
+
+      /**
+       * A query sent by a router on the link: the clients answer with a report within the maximum response time.
+       * A general query carries the any address as group and source.
+       */
+      struct IgmpQueryMessage
+      {
+        Ipv4Address m_multicastGroupAddr;
+        Ipv4Address m_sourceAddr;
+        uint32_t m_maxResponseTime;
+
+        void Print(std::ostream &os) const;
+        uint32_t GetSerializedSize(void) const;
+        void Serialize(Buffer::Iterator start) const;
+        uint32_t Deserialize(Buffer::Iterator start, uint32_t messageSize);
+      };
+
     private:
       struct
       {
         IgmpReportMessage igmpReport;
         IgmpAcceptMessage igmpAccept;
+        IgmpMultiReportMessage igmpMultiReport;
+        IgmpMultiAcceptMessage igmpMultiAccept;
+        IgmpLeaveMessage igmpLeave;
+        IgmpQueryMessage igmpQuery;
       } m_igmpx_message;
 
     public:
@@ -187,6 +297,62 @@ namespace ns3
           }
         return m_igmpx_message.igmpAccept;
       }
+
+      IgmpMultiReportMessage&
+      GetIgmpMultiReportMessage()
+      {
+        if (m_type == 0)
+          {
+            m_type = IGMPX_REPORT_MULTI;
+          }
+        else
+          {
+            NS_ASSERT(m_type == IGMPX_REPORT_MULTI);
+          }
+        return m_igmpx_message.igmpMultiReport;
+      }
+
+      IgmpMultiAcceptMessage&
+      GetIgmpMultiAcceptMessage()
+      {
+        if (m_type == 0)
+          {
+            m_type = IGMPX_ACCEPT_MULTI;
+          }
+        else
+          {
+            NS_ASSERT(m_type == IGMPX_ACCEPT_MULTI);
+          }
+        return m_igmpx_message.igmpMultiAccept;
+      }
+
+      IgmpLeaveMessage&
+      GetIgmpLeaveMessage()
+      {
+        if (m_type == 0)
+          {
+            m_type = IGMPX_LEAVE;
+          }
+        else
+          {
+            NS_ASSERT(m_type == IGMPX_LEAVE);
+          }
+        return m_igmpx_message.igmpLeave;
+      }
+
+      IgmpQueryMessage&
+      GetIgmpQueryMessage()
+      {
+        if (m_type == 0)
+          {
+            m_type = IGMPX_QUERY;
+          }
+        else
+          {
+            NS_ASSERT(m_type == IGMPX_QUERY);
+          }
+        return m_igmpx_message.igmpQuery;
+      }
     };
 
     static inline std::ostream&
@@ -28,7 +28,7 @@
 #include <ns3/udp-socket.h>
 #include <ns3/simulator.h>
 #include <ns3/names.h>
-#include <ns3/random-variable.h>
+#include <ns3/random-variable-stream.h>
 #include <ns3/inet-socket-address.h>
 #include <ns3/ipv4-routing-protocol.h>
 #include <ns3/ipv4-routing-table-entry.h>
@@ -59,12 +59,24 @@ namespace ns3
 
     IGMPXRoutingProtocol::IGMPXRoutingProtocol () :
         m_mainInterface (0), m_mainAddress (Ipv4Address::GetAny ()), m_stopTx (false), m_ipv4 (0), m_identification (0),
-        m_routingProtocol (0), m_RoutingTable (0), m_startTime (0), m_renew (Timer::CANCEL_ON_DESTROY), m_role (CLIENT),
-        pimdm (0), video (0)
+        m_routingProtocol (0), m_RoutingTable (0), m_startTime (0), m_renew (Timer::CANCEL_ON_DESTROY),
+        m_reportAggregation (true), m_lazyClientExpiry (true), m_acceptAggregation (true), m_snrAlpha (1.0), m_snrHysteresis (0.0),
+        m_minDwellTime (Seconds (0)), m_avoidedSwitches (0), m_routerCandidates (3),
+        m_candidateLifetime (Seconds (IGMP_RENEW + 1)),
+        m_lastMemberTime (Seconds (3)), m_txPolicy (TX_BROADCAST),
+        m_broadcastRate ("1Mbps"), m_unicastRate ("11Mbps"), m_unicastTxPackets (0), m_savedAirtime (Seconds (0)), m_txQueueWindow (Seconds (1)), m_maxPduSize (1400),
+        m_queryMode (false), m_queryInterval (Seconds (20)), m_queryResponseInterval (Seconds (5)),
+        m_reportSuppression (false), m_suppressedReports (0), m_membershipBatch (MilliSeconds (100)), m_role (CLIENT), pimdm (0), video (0)
     {
       m_RoutingTable = Create<Ipv4StaticRouting> ();
-      m_socketAddresses.clear ();
-      m_igmpGroups.clear ();
+      m_uniformRandom = CreateObject<UniformRandomVariable> ();
+      m_interfaceSockets.clear ();
+      m_pendingReports.clear ();
+      m_reportFlush.clear ();
+      m_pendingAccepts.clear ();
+      m_acceptFlush.clear ();
+      m_txQueues.clear ();
+      m_membershipLog.clear ();
     }
 
     IGMPXRoutingProtocol::~IGMPXRoutingProtocol ()
@@ -83,10 +95,76 @@ namespace ns3
                            StringValue ("0,0,0"), MakeStringAccessor (&IGMPXRoutingProtocol::UnregisterInterfaceString), MakeStringChecker ())
             .AddAttribute ("PeerRole", "Peer role.", EnumValue (CLIENT), MakeEnumAccessor (&IGMPXRoutingProtocol::m_role),
                            MakeEnumChecker (CLIENT, "Node is a client.", ROUTER, "Node is a router."))
+            .AddAttribute ("GroupSource", "Make a source of a group known to a router, for the any-source clients. Tuple (source, group), set after PeerRole.",
+                           StringValue ("0,0"), MakeStringAccessor (&IGMPXRoutingProtocol::AddGroupSourceString),
+                           MakeStringChecker ())
+            .AddAttribute ("ReportAggregation", "Send all the reports due on an interface in a single multi-record report.",
+                           BooleanValue (true), MakeBooleanAccessor (&IGMPXRoutingProtocol::m_reportAggregation),
+                           MakeBooleanChecker ())
+            .AddAttribute ("AcceptAggregation", "Routers answer all the clients of a Source-Group pair heard on an interface with a single accept.",
+                           BooleanValue (true), MakeBooleanAccessor (&IGMPXRoutingProtocol::m_acceptAggregation),
+                           MakeBooleanChecker ())
+            .AddAttribute ("SnrSmoothing", "Weight of a new SNR sample in the moving average of a router SNR, 1 disables the smoothing.",
+                           DoubleValue (1.0), MakeDoubleAccessor (&IGMPXRoutingProtocol::m_snrAlpha),
+                           MakeDoubleChecker<double> (0.0, 1.0))
+            .AddAttribute ("SnrHysteresis", "Extra margin a candidate router needs: it is chosen if the SNR ratio is below IGMP_SNR_RATIO*(1-SnrHysteresis).",
+                           DoubleValue (0.0), MakeDoubleAccessor (&IGMPXRoutingProtocol::m_snrHysteresis),
+                           MakeDoubleChecker<double> (0.0, 1.0))
+            .AddAttribute ("MinDwellTime", "Shortest time a client stays with a router before changing it for a better one.",
+                           TimeValue (Seconds (0)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_minDwellTime),
+                           MakeTimeChecker ())
+            .AddAttribute ("RouterCandidates", "Routers remembered per Source-Group pair, to fail over without a new discovery.",
+                           UintegerValue (3), MakeUintegerAccessor (&IGMPXRoutingProtocol::m_routerCandidates),
+                           MakeUintegerChecker<uint32_t> (1))
+            .AddAttribute ("CandidateLifetime", "Age after which a router not heard any more is not a failover candidate.",
+                           TimeValue (Seconds (IGMP_RENEW + 1)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_candidateLifetime),
+                           MakeTimeChecker ())
+            .AddAttribute ("LastMemberTime", "Time the other clients of an interface have to answer a leave, before the router removes the interface.",
+                           TimeValue (Seconds (3)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_lastMemberTime),
+                           MakeTimeChecker ())
+            .AddAttribute ("TxPolicy", "Transmission policy of the messages between associated clients and routers.",
+                           EnumValue (TX_BROADCAST), MakeEnumAccessor (&IGMPXRoutingProtocol::m_txPolicy),
+                           MakeEnumChecker (TX_BROADCAST, "Broadcast", TX_UNICAST_ASSOCIATED, "UnicastAssociated"))
+            .AddAttribute ("BroadcastRate", "Rate of the broadcast frames, used to estimate the airtime saved by unicast.",
+                           DataRateValue (DataRate ("1Mbps")), MakeDataRateAccessor (&IGMPXRoutingProtocol::m_broadcastRate),
+                           MakeDataRateChecker ())
+            .AddAttribute ("UnicastRate", "Rate of the unicast frames, used to estimate the airtime saved by unicast.",
+                           DataRateValue (DataRate ("11Mbps")), MakeDataRateAccessor (&IGMPXRoutingProtocol::m_unicastRate),
+                           MakeDataRateChecker ())
+            .AddAttribute ("LazyClientExpiry", "Routers record the time of the last client report and check it when the timeout fires, instead of rescheduling the timeout on every report.",
+                           BooleanValue (true), MakeBooleanAccessor (&IGMPXRoutingProtocol::m_lazyClientExpiry),
+                           MakeBooleanChecker ())
+            .AddAttribute ("TimerResolution", "Tick of the wheel running the membership timers.",
+                           TimeValue (MilliSeconds (10)),
+                           MakeTimeAccessor (&IGMPXRoutingProtocol::SetTimerResolution, &IGMPXRoutingProtocol::GetTimerResolution),
+                           MakeTimeChecker ())
+            .AddAttribute ("TxQueueWindow", "Largest delay of a broadcast message, the messages due on an interface within this delay are sent in one packet. Zero sends each message on its own after a random delay.",
+                           TimeValue (Seconds (1)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_txQueueWindow),
+                           MakeTimeChecker ())
+            .AddAttribute ("MaxPduSize", "Largest size in bytes of the IGMPX messages sent in one packet.",
+                           UintegerValue (1400), MakeUintegerAccessor (&IGMPXRoutingProtocol::m_maxPduSize),
+                           MakeUintegerChecker<uint32_t> ())
+            .AddAttribute ("QueryMode", "Routers send general and group-specific queries, clients report only to answer them instead of periodically.",
+                           BooleanValue (false), MakeBooleanAccessor (&IGMPXRoutingProtocol::m_queryMode),
+                           MakeBooleanChecker ())
+            .AddAttribute ("QueryInterval", "Period of the general queries of the routers in query mode.",
+                           TimeValue (Seconds (20)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_queryInterval),
+                           MakeTimeChecker ())
+            .AddAttribute ("QueryResponseInterval", "Longest delay of the answer of a client to a general query.",
+                           TimeValue (Seconds (5)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_queryResponseInterval),
+                           MakeTimeChecker ())
+            .AddAttribute ("MembershipBatch", "Period over which the membership changes of a router are coalesced before PIM-DM hears them, zero to pass each change at once.",
+                           TimeValue (MilliSeconds (100)), MakeTimeAccessor (&IGMPXRoutingProtocol::m_membershipBatch),
+                           MakeTimeChecker ())
+            .AddAttribute ("ReportSuppression", "Clients skip a pending report when they hear the same report from another client. Needs broadcast accepts.",
+                           BooleanValue (false), MakeBooleanAccessor (&IGMPXRoutingProtocol::m_reportSuppression),
+                           MakeBooleanChecker ())
             .AddTraceSource ("IgmpxRxControl", "Trace Igmpx packet received.",
                            MakeTraceSourceAccessor (&IGMPXRoutingProtocol::m_rxControlPacketTrace))
             .AddTraceSource ("IgmpxTxControl", "Trace Igmpx packet sent.",
-                           MakeTraceSourceAccessor (&IGMPXRoutingProtocol::m_txControlPacketTrace));
+                           MakeTraceSourceAccessor (&IGMPXRoutingProtocol::m_txControlPacketTrace))
+            .AddTraceSource ("MembershipCount", "Number of clients of a Source-Group pair on a router interface, on every change.",
+                           MakeTraceSourceAccessor (&IGMPXRoutingProtocol::m_membershipTrace));
       return tid;
     }
 
@@ -98,7 +176,113 @@ namespace ns3
 
     void
     IGMPXRoutingProtocol::SetInterfaceExclusions (std::set<uint32_t> exceptions)
-    {}
+    {
+      // The helper sets the exclusions before the interfaces come up, but they may be changed later.
+      std::set<uint32_t> previous = m_interfaceExclusions;
+      m_interfaceExclusions = exceptions;
+      for (std::set<uint32_t>::const_iterator iter = m_interfaceExclusions.begin (); iter != m_interfaceExclusions.end (); iter++)
+        {
+          if (previous.find (*iter) == previous.end ())
+            PurgeInterface (*iter);
+        }
+      for (std::set<uint32_t>::const_iterator iter = previous.begin (); iter != previous.end (); iter++)
+        {
+          if (m_interfaceExclusions.find (*iter) == m_interfaceExclusions.end ())
+            RestoreInterface (*iter);
+        }
+    }
+
+    std::set<uint32_t>
+    IGMPXRoutingProtocol::GetInterfaceExclusions () const
+    {
+      return m_interfaceExclusions;
+    }
+
+    void
+    IGMPXRoutingProtocol::SetTimerResolution (Time resolution)
+    {
+      m_timerWheel.SetResolution (resolution);
+    }
+
+    Time
+    IGMPXRoutingProtocol::GetTimerResolution () const
+    {
+      return m_timerWheel.GetResolution ();
+    }
+
+    uint32_t
+    IGMPXRoutingProtocol::GetUnicastTxPackets () const
+    {
+      return m_unicastTxPackets;
+    }
+
+    uint32_t
+    IGMPXRoutingProtocol::GetAvoidedSwitches () const
+    {
+      return m_avoidedSwitches;
+    }
+
+    uint32_t
+    IGMPXRoutingProtocol::GetSuppressedReports () const
+    {
+      return m_suppressedReports;
+    }
+
+    int64_t
+    IGMPXRoutingProtocol::AssignStreams (int64_t stream)
+    {
+      NS_LOG_FUNCTION (this << stream);
+      m_uniformRandom->SetStream (stream);
+      return 1;
+    }
+
+    uint32_t
+    IGMPXRoutingProtocol::GetClientCount (Ipv4Address source, Ipv4Address group, uint32_t interface)
+    {
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (source, group));
+      if (m_role != ROUTER || state == 0)
+        return 0;
+      ExpireClients (state, interface);
+      std::map<uint32_t, ClientSet>::const_iterator members = state->igmpClients.find (interface);
+      return members == state->igmpClients.end () ? 0 : members->second.Size ();
+    }
+
+    std::vector<Ipv4Address>
+    IGMPXRoutingProtocol::GetClients (Ipv4Address source, Ipv4Address group, uint32_t interface)
+    {
+      std::vector<Ipv4Address> clients;
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (source, group));
+      if (m_role != ROUTER || state == 0)
+        return clients;
+      ExpireClients (state, interface);
+      std::map<uint32_t, ClientSet>::const_iterator members = state->igmpClients.find (interface);
+      if (members == state->igmpClients.end ())
+        return clients;
+      clients.reserve (members->second.Size ());
+      for (uint32_t i = 0; i < members->second.Size (); i++)
+        {
+          clients.push_back (members->second.GetClient (i));
+        }
+      return clients;
+    }
+
+    void
+    IGMPXRoutingProtocol::SetPeerRole (PeerRole role)
+    {
+      m_role = role;
+    }
+
+    PeerRole
+    IGMPXRoutingProtocol::GetPeerRole () const
+    {
+      return m_role;
+    }
+
+    Time
+    IGMPXRoutingProtocol::GetSavedAirtime () const
+    {
+      return m_savedAirtime;
+    }
 
     void
     IGMPXRoutingProtocol::RegisterInterface (Ipv4Address source, Ipv4Address group, uint32_t interface)
@@ -106,26 +290,32 @@ namespace ns3
       NS_ASSERT (m_role == CLIENT);
       NS_LOG_DEBUG ("Register interface  " << interface << " for (" << source << "," << group << ")");
       SourceGroupPair sgp (source, group);
-      if (m_igmpGroups.find (sgp) == m_igmpGroups.end ())//check whether the SourceGroup pair has been registered
+      if (m_interfaceExclusions.find (interface) != m_interfaceExclusions.end ())
+        {
+          NS_LOG_WARN ("Interface " << interface << " is excluded: (" << source << "," << group << ") waits for its restore");
+          m_excludedPairs[interface].insert (PackSourceGroup (sgp));
+          return;
+        }
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      if (state == 0)//check whether the SourceGroup pair has been registered
         {
-          IgmpState istate (sgp); // Create a new source group element
-          m_igmpGroups.insert (std::pair<SourceGroupPair, IgmpState> (sgp, istate));
-          m_igmpGroups.find (sgp)->second.igmpPair.m_renew.SetDelay (Seconds (IGMP_RENEW));
-          m_igmpGroups.find (sgp)->second.igmpPair.m_renew.SetFunction (&IGMPXRoutingProtocol::SendIgmpRegister, this);
-          m_igmpGroups.find (sgp)->second.igmpPair.m_renew.SetArguments (sgp, interface);
-          m_igmpGroups.find (sgp)->second.igmpPair.m_renew.Schedule(m_startTime + TransmissionDelay (IGMP_RENEW * 900, IGMP_RENEW * 1100, Time::MS));
+          state = m_igmpGroups.Insert (PackSourceGroup (sgp), IgmpState (sgp, &m_timerWheel)); // Create a new source group element
+          m_groupFilter.Insert (group);
         }
       // check whether the SourceGroup pair is registered on the given interface, otherwise create a new one.
-      if (m_igmpGroups.find (sgp)->second.igmpReport.find (interface) == m_igmpGroups.find (sgp)->second.igmpReport.end ())
+      std::map<uint32_t, IgmpTimer>::iterator report = state->igmpReport.find (interface);
+      if (report == state->igmpReport.end ())
         {
-          m_igmpGroups.find (sgp)->second.igmpReport.insert (std::pair<uint32_t, Timer> (interface, Timer (Timer::CANCEL_ON_DESTROY)));
-          m_igmpGroups.find (sgp)->second.igmpLife.SetFunction (&IGMPXRoutingProtocol::RemoveRouter, this);
-          m_igmpGroups.find (sgp)->second.igmpLife.SetDelay (Seconds (IGMP_RENEW + 1));
-          m_igmpGroups.find (sgp)->second.igmpLife.SetArguments (sgp, interface);
+          report = state->igmpReport.insert (std::pair<uint32_t, IgmpTimer> (interface, IgmpTimer (&m_timerWheel))).first;
+          state->igmpLife.SetFunction (&IGMPXRoutingProtocol::RemoveRouter, this);
+          // In query mode the router is heard once per query: it is kept across a lost query.
+          state->igmpLife.SetDelay (m_queryMode ? m_queryInterval + m_queryInterval + m_queryResponseInterval + Seconds (1)
+                                                : Seconds (IGMP_RENEW + 1));
+          state->igmpLife.SetArguments (sgp, interface);
         }
-      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetFunction (&IGMPXRoutingProtocol::IgmpReportTimerExpire, this);
-      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetArguments (sgp, interface);
-      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetDelay (Seconds (IGMP_TIME));
+      report->second.SetFunction (&IGMPXRoutingProtocol::IgmpReportTimerExpire, this);
+      report->second.SetArguments (sgp, interface);
+      report->second.SetDelay (Seconds (IGMP_TIME));
       Simulator::Schedule (m_startTime + TransmissionDelay (), &IGMPXRoutingProtocol::IgmpReportTimerExpire, this, sgp,
           interface);
     }
@@ -156,13 +346,218 @@ namespace ns3
       NS_ASSERT (m_role == CLIENT);
       NS_LOG_DEBUG ("UnRegister interface with members for (" << source << "," << group << ") over interface " << interface);
       SourceGroupPair sgp (source, group);
-      if (m_igmpGroups.find (sgp)->second.igmpReport.find (interface) != m_igmpGroups.find (sgp)->second.igmpReport.end ())
+      std::map<uint32_t, std::set<uint64_t> >::iterator excluded = m_excludedPairs.find (interface);
+      if (excluded != m_excludedPairs.end ())
+        excluded->second.erase (PackSourceGroup (sgp));
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      if (state == 0)
+        return;
+      std::map<uint32_t, IgmpTimer>::iterator report = state->igmpReport.find (interface);
+      if (report != state->igmpReport.end ())
+        {
+          report->second.Cancel (); //cancel timer
+          state->igmpReport.erase (report);
+          // A register still pending would follow the leave and make the router take the client back.
+          state->igmpRegister.Cancel ();
+          DropPendingReports (sgp, interface);
+          if (state->igmpPair.nextMulticastAddr != Ipv4Address::GetAny ())
+            SendIgmpLeave (sgp, interface, state->igmpPair.nextMulticastAddr);
+          if (!state->igmpReport.empty () && state->igmpPair.nextMulticastAddr != Ipv4Address::GetAny ())
+            {
+              // The register cancelled may have been due on another interface.
+              state->igmpRegister = Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendIgmpRegister,
+                  this, sgp, state->igmpReport.begin ()->first);
+            }
+        }
+      if (state->igmpReport.empty ())
+        { // Nothing left to renew: forget the pair and its router, the timers go with the state.
+          state->igmpRegister.Cancel ();
+          m_igmpGroups.Erase (PackSourceGroup (sgp));
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::SendIgmpLeave (SourceGroupPair sgp, uint32_t interface, Ipv4Address router)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << router);
+      NS_ASSERT (m_role == CLIENT);
+      IGMPXHeader leave (IGMPX_LEAVE);
+      IGMPXHeader::IgmpLeaveMessage &igmpLeave = leave.GetIgmpLeaveMessage ();
+      igmpLeave.m_multicastGroupAddr = sgp.groupMulticastAddr;
+      igmpLeave.m_sourceAddr = sgp.sourceMulticastAddr;
+      igmpLeave.m_upstreamAddr = router;
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " leaves " << sgp << " of router " << router);
+      // Broadcast, so that the other clients of the router can answer.
+      EnqueueIGMPX (leave, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::RecvIgmpLeave (IGMPXHeader::IgmpLeaveMessage &leave, Ipv4Address sender,
+                                         Ipv4Address receiver, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << sender << receiver << interface);
+      SourceGroupPair sgp (leave.m_sourceAddr, leave.m_multicastGroupAddr);
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      if (state == 0)
+        return;
+      switch (m_role)
         {
-          m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Cancel (); //cancel timer
-          m_igmpGroups.find (sgp)->second.igmpReport.erase (interface);
+        case CLIENT:
+          {
+            if (m_queryMode)
+              break; // the router queries the pair, the answer follows the query
+            if (state->igmpPair.nextMulticastAddr == leave.m_upstreamAddr
+                && state->igmpReport.find (interface) != state->igmpReport.end ())
+              {
+                NS_LOG_INFO ("Client " << receiver << " answers the leave of " << sender << " for " << sgp);
+                Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendIgmpRegister, this, sgp, interface);
+              }
+            break;
+          }
+        case ROUTER:
+          {
+            if (!IsMyOwnAddress (leave.m_upstreamAddr))
+              break;
+            std::map<uint32_t, IgmpTimer>::iterator clients = state->igmpReport.find (interface);
+            if (clients == state->igmpReport.end ())
+              break;
+            std::map<uint32_t, ClientSet>::iterator members = state->igmpClients.find (interface);
+            if (members != state->igmpClients.end ())
+              {
+                if (members->second.Remove (sender))
+                  m_membershipTrace (sgp.sourceMulticastAddr, sgp.groupMulticastAddr, interface, members->second.Size ());
+                ExpireClients (state, interface);
+                if (!members->second.Empty ())
+                  {
+                    // Other clients are known on the interface: nothing to check.
+                    NS_LOG_INFO ("Router " << receiver << " keeps " << sgp << " after the leave of " << sender << ", "
+                        << members->second.Size () << " clients left");
+                    break;
+                  }
+              }
+            NS_LOG_INFO ("Router " << receiver << " checks the last member of " << sgp << " after the leave of " << sender);
+            // Only a report received from now on keeps the interface: the last one is pushed a whole timeout back.
+            state->igmpLastSeen[interface] = Simulator::Now () - Seconds (IGMP_TIMEOUT);
+            clients->second.Schedule (m_lastMemberTime);
+            if (m_queryMode)
+              {
+                // The answers have a third of the time, the rest covers the transmission delays.
+                SendIgmpQuery (sgp, interface, MilliSeconds (m_lastMemberTime.GetMilliSeconds () / 3));
+              }
+            break;
+          }
+        default:
+          {
+            NS_ASSERT_MSG (false, "State not valid "<< m_role);
+            break;
+          }
         }
     }
 
+    void
+    IGMPXRoutingProtocol::SendGeneralQuery ()
+    {
+      NS_LOG_FUNCTION (this);
+      NS_ASSERT (m_role == ROUTER);
+      for (uint32_t i = 0; i < m_interfaceSockets.size (); i++)
+        {
+          if (m_interfaceSockets[i].socket != 0)
+            SendIgmpQuery (SourceGroupPair (Ipv4Address::GetAny (), Ipv4Address::GetAny ()), i, m_queryResponseInterval);
+        }
+      m_queryEvent = Simulator::Schedule (m_queryInterval, &IGMPXRoutingProtocol::SendGeneralQuery, this);
+    }
+
+    void
+    IGMPXRoutingProtocol::SendIgmpQuery (SourceGroupPair sgp, uint32_t interface, Time maxResponse)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << maxResponse);
+      NS_ASSERT (m_role == ROUTER);
+      IGMPXHeader query (IGMPX_QUERY);
+      IGMPXHeader::IgmpQueryMessage &igmpQuery = query.GetIgmpQueryMessage ();
+      igmpQuery.m_multicastGroupAddr = sgp.groupMulticastAddr;
+      igmpQuery.m_sourceAddr = sgp.sourceMulticastAddr;
+      igmpQuery.m_maxResponseTime = maxResponse.GetMilliSeconds ();
+      NS_LOG_INFO ("Router " << GetLocalAddress (interface) << " queries " << sgp << " on interface " << interface);
+      EnqueueIGMPX (query, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::RecvIgmpQuery (IGMPXHeader::IgmpQueryMessage &query, Ipv4Address sender,
+                                         Ipv4Address receiver, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << sender << receiver << interface);
+      if (m_role != CLIENT || !m_queryMode)
+        return;
+      bool general = query.m_multicastGroupAddr == Ipv4Address::GetAny ();
+      for (uint32_t i = 0; i < m_igmpGroups.Size (); i++)
+        {
+          IgmpState *state = m_igmpGroups.Get (i);
+          if (!general && (state->igmpPair.groupMulticastAddr != query.m_multicastGroupAddr
+              || state->igmpPair.sourceMulticastAddr != query.m_sourceAddr))
+            continue;
+          // The queries of other routers are left to their clients.
+          if (state->igmpPair.nextMulticastAddr != Ipv4Address::GetAny () && state->igmpPair.nextMulticastAddr != sender)
+            continue;
+          std::map<uint32_t, IgmpTimer>::iterator report = state->igmpReport.find (interface);
+          if (report == state->igmpReport.end ())
+            continue;
+          Time delay = TransmissionDelay (0, query.m_maxResponseTime, Time::MS);
+          if (report->second.IsRunning () && report->second.GetDelayLeft () <= delay)
+            continue;
+          NS_LOG_INFO ("Client " << receiver << " answers the query of " << sender << " for " << state->igmpPair << " in " << delay.GetSeconds ());
+          report->second.Cancel ();
+          report->second.Schedule (delay);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::AddGroupSource (Ipv4Address source, Ipv4Address group)
+    {
+      NS_LOG_FUNCTION (this << source << group);
+      if (m_role != ROUTER || source == Ipv4Address::GetAny ())
+        return;
+      std::vector<PimMembership::Change> changes;
+      if (!m_pimMembership.AddSource (source, group, changes))
+        return; // already known
+      NS_LOG_INFO ("Router learns source " << source << " of group " << group);
+      for (std::vector<PimMembership::Change>::const_iterator iter = changes.begin (); iter != changes.end (); iter++)
+        {
+          NotifyMembership (SourceGroupPair (iter->source, iter->group), iter->interface, iter->member);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::LearnSource (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      if (m_role != ROUTER)
+        return;
+      Ipv4Header header;
+      if (packet->PeekHeader (header) == 0)
+        return;
+      Ipv4Address group = header.GetDestination ();
+      // The local network control block (224.0.0.0/24) carries the routing protocols, not group data.
+      if (!group.IsMulticast () || (group.Get () & 0xffffff00) == 0xe0000000 || header.GetProtocol () == IGMPX_IP_PROTOCOL_NUM)
+        return;
+      if (!m_pimMembership.IsSourceKnown (header.GetSource (), group))
+        AddGroupSource (header.GetSource (), group);
+    }
+
+    void
+    IGMPXRoutingProtocol::AddGroupSourceString (std::string csv)
+    {
+      NS_LOG_FUNCTION (this);
+      std::vector<std::string> tokens;
+      Tokenize (csv, tokens, ",");
+      if (tokens.size () != 2)
+        return;
+      Ipv4Address source = Ipv4Address (tokens.at (0).c_str ());
+      Ipv4Address group = Ipv4Address (tokens.at (1).c_str ());
+      tokens.clear ();
+      if (source == group)
+        return; //skip initialization
+      AddGroupSource (source, group);
+    }
+
     void
     IGMPXRoutingProtocol::UnregisterInterfaceString (std::string csv)
     {
@@ -203,16 +598,7 @@ namespace ns3
     bool
     IGMPXRoutingProtocol::IsMyOwnAddress (const Ipv4Address & address) const
     {
-      for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin ();
-          j != m_socketAddresses.end (); ++j)
-        {
-          Ipv4InterfaceAddress iface = j->second;
-          if (address == iface.GetLocal ())
-            {
-              return true;
-            }
-        }
-      return false;
+      return m_localAddresses.Contains (address);
     }
 
     void
@@ -228,19 +614,52 @@ namespace ns3
             }
         }
       NS_ASSERT (m_mainAddress != Ipv4Address ());
+      if (i >= m_interfaceSockets.size () || m_interfaceSockets[i].socket == 0)
+        {
+          OpenInterfaceSocket (i);
+        }
     }
 
     void
     IGMPXRoutingProtocol::NotifyInterfaceDown (uint32_t i)
     {
       NS_LOG_FUNCTION (this << i);
+      CloseInterfaceSocket (i);
     }
 
     void
     IGMPXRoutingProtocol::NotifyAddAddress (uint32_t j, Ipv4InterfaceAddress address)
     {
       NS_LOG_FUNCTION (this << GetObject<Node> ()->GetId ());
+      if (j < m_interfaceSockets.size () && m_interfaceSockets[j].socket != 0)
+        return; // The socket is already open on the first address of the interface.
+      OpenInterfaceSocket (j);
+    }
+
+    void
+    IGMPXRoutingProtocol::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+    {
+      NS_LOG_FUNCTION (this<<interface);
+      if (interface >= m_interfaceSockets.size () || m_interfaceSockets[interface].local != address.GetLocal ())
+        return;
+      // The socket address is gone: move the socket to the address left, if any.
+      CloseInterfaceSocket (interface);
+      if (m_ipv4->GetNAddresses (interface) > 0)
+        {
+          OpenInterfaceSocket (interface);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::OpenInterfaceSocket (uint32_t j)
+    {
+      NS_LOG_FUNCTION (this << j);
       int32_t i = (int32_t) j;
+      if (m_interfaceExclusions.find (j) != m_interfaceExclusions.end ())
+        {
+          NS_LOG_DEBUG ("Interface " << j << " is excluded: no socket");
+          return;
+        }
       Ipv4Address addr = m_ipv4->GetAddress (i, 0).GetLocal ();
       if (addr == Ipv4Address::GetLoopback ())
         return;
@@ -256,17 +675,123 @@ namespace ns3
           NS_FATAL_ERROR ("Failed to bind () IGMPX socket " << addr << ":" << IGMPX_PORT_NUM);
         }
       socket->BindToNetDevice (m_ipv4->GetNetDevice (i));
-      m_socketAddresses[socket] = m_ipv4->GetAddress (i, 0);
+      m_localAddresses.Insert (addr, j);
+      m_socketInterfaces[socket] = j;
+      if (j >= m_interfaceSockets.size ())
+        {
+          m_interfaceSockets.resize (j + 1);
+        }
+      InterfaceSocket &entry = m_interfaceSockets[j];
+      entry.socket = socket;
+      entry.local = addr;
+      entry.broadcast = addr.GetSubnetDirectedBroadcast (m_ipv4->GetAddress (i, 0).GetMask ());
       NS_LOG_DEBUG ("Socket " << socket << " Device " << m_ipv4->GetNetDevice (i) << " Iface " << i
           << " Addr " << addr
-          << " Broad " << addr.GetSubnetDirectedBroadcast (m_ipv4->GetAddress (i, 0).GetMask ())
+          << " Broad " << entry.broadcast
       );
     }
 
     void
-    IGMPXRoutingProtocol::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+    IGMPXRoutingProtocol::CloseInterfaceSocket (uint32_t interface)
     {
-      NS_LOG_FUNCTION (this<<interface);
+      NS_LOG_FUNCTION (this << interface);
+      if (interface >= m_interfaceSockets.size () || m_interfaceSockets[interface].socket == 0)
+        return;
+      InterfaceSocket &entry = m_interfaceSockets[interface];
+      entry.socket->Close ();
+      m_socketInterfaces.erase (entry.socket);
+      m_localAddresses.Erase (entry.local);
+      entry = InterfaceSocket ();
+    }
+
+    void
+    IGMPXRoutingProtocol::PurgeInterface (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      CloseInterfaceSocket (interface);
+      std::map<uint32_t, TxQueue>::iterator queue = m_txQueues.find (interface);
+      if (queue != m_txQueues.end ())
+        {
+          queue->second.flush.Cancel ();
+          m_txQueues.erase (queue);
+        }
+      m_reportFlush[interface].Cancel ();
+      m_reportFlush.erase (interface);
+      m_pendingReports.erase (interface);
+      m_acceptFlush[interface].Cancel ();
+      m_acceptFlush.erase (interface);
+      m_pendingAccepts.erase (interface);
+      for (std::map<std::pair<Ipv4Address, uint32_t>, EventId>::iterator iter = m_routerRefresh.begin ();
+          iter != m_routerRefresh.end ();)
+        {
+          if (iter->first.second != interface)
+            {
+              iter++;
+              continue;
+            }
+          iter->second.Cancel ();
+          m_routerRefresh.erase (iter++);
+        }
+      // The states are collected first: dropping the last interface of a state erases it from the table.
+      std::vector<SourceGroupPair> pairs;
+      for (uint32_t i = 0; i < m_igmpGroups.Size (); i++)
+        {
+          IgmpState *state = m_igmpGroups.Get (i);
+          if (state->igmpReport.find (interface) != state->igmpReport.end ())
+            pairs.push_back (SourceGroupPair (state->igmpPair.sourceMulticastAddr, state->igmpPair.groupMulticastAddr));
+        }
+      for (std::vector<SourceGroupPair>::const_iterator sgp = pairs.begin (); sgp != pairs.end (); sgp++)
+        {
+          if (m_role == ROUTER)
+            {
+              // The clients are forgotten and PIM-DM stops forwarding the pair on the interface.
+              RemoveClients (*sgp, interface);
+              continue;
+            }
+          IgmpState *state = m_igmpGroups.Find (PackSourceGroup (*sgp));
+          state->igmpReport.find (interface)->second.Cancel ();
+          state->igmpReport.erase (interface);
+          m_excludedPairs[interface].insert (PackSourceGroup (*sgp));
+          if (state->igmpReport.empty ())
+            {
+              state->igmpRegister.Cancel ();
+              m_igmpGroups.Erase (PackSourceGroup (*sgp));
+            }
+          else
+            {
+              // The router lifetime expires on an interface still registered.
+              state->igmpLife.SetArguments (*sgp, state->igmpReport.begin ()->first);
+            }
+        }
+      NS_LOG_INFO ("Interface " << interface << " excluded, " << pairs.size () << " pairs dropped");
+    }
+
+    void
+    IGMPXRoutingProtocol::RestoreInterface (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      if (m_ipv4 != 0 && interface < m_ipv4->GetNInterfaces () && m_ipv4->IsUp (interface)
+          && m_ipv4->GetNAddresses (interface) > 0)
+        OpenInterfaceSocket (interface);
+      if (m_role == ROUTER)
+        {
+          if (m_queryMode && interface < m_interfaceSockets.size () && m_interfaceSockets[interface].socket != 0)
+            SendIgmpQuery (SourceGroupPair (Ipv4Address::GetAny (), Ipv4Address::GetAny ()), interface,
+                m_queryResponseInterval);
+          return;
+        }
+      std::map<uint32_t, std::set<uint64_t> >::iterator excluded = m_excludedPairs.find (interface);
+      if (excluded == m_excludedPairs.end ())
+        return;
+      std::set<uint64_t> pairs;
+      pairs.swap (excluded->second);
+      m_excludedPairs.erase (excluded);
+      for (std::set<uint64_t>::const_iterator iter = pairs.begin (); iter != pairs.end (); iter++)
+        {
+          // The packed key holds the group in the upper half, the source in the lower one.
+          RegisterInterface (Ipv4Address (static_cast<uint32_t> (*iter)), Ipv4Address (static_cast<uint32_t> (*iter >> 32)),
+              interface);
+        }
     }
 
     void
@@ -276,6 +801,8 @@ namespace ns3
       NS_ASSERT (m_ipv4 == 0);
       m_ipv4 = ipv4;
       m_RoutingTable->SetIpv4 (ipv4);
+      // Routers learn the sources of the groups from the data they receive, for the any-source entries.
+      m_ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&IGMPXRoutingProtocol::LearnSource, this));
     }
 
     inline Ipv4Address
@@ -290,13 +817,45 @@ namespace ns3
     {
       m_ipv4 = 0;
       m_RoutingTable = 0;
-      for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::iterator iter = m_socketAddresses.begin ();
-          iter != m_socketAddresses.end (); iter++)
+      for (std::vector<InterfaceSocket>::iterator iter = m_interfaceSockets.begin (); iter != m_interfaceSockets.end (); iter++)
+        {
+          if (iter->socket != 0)
+            iter->socket->Close ();
+        }
+      m_interfaceSockets.clear ();
+      m_socketInterfaces.clear ();
+      m_localAddresses.Clear ();
+      m_excludedPairs.clear ();
+      m_igmpGroups.Clear ();
+      m_groupFilter.Clear ();
+      m_timerWheel.Clear ();
+      for (std::map<uint32_t, EventId>::iterator iter = m_reportFlush.begin (); iter != m_reportFlush.end (); iter++)
+        {
+          iter->second.Cancel ();
+        }
+      m_reportFlush.clear ();
+      m_pendingReports.clear ();
+      for (std::map<uint32_t, EventId>::iterator iter = m_acceptFlush.begin (); iter != m_acceptFlush.end (); iter++)
+        {
+          iter->second.Cancel ();
+        }
+      m_acceptFlush.clear ();
+      m_pendingAccepts.clear ();
+      for (std::map<uint32_t, TxQueue>::iterator iter = m_txQueues.begin (); iter != m_txQueues.end (); iter++)
         {
-          iter->first->Close ();
+          iter->second.flush.Cancel ();
         }
-      m_socketAddresses.clear ();
-      m_igmpGroups.clear ();
+      m_txQueues.clear ();
+      m_queryEvent.Cancel ();
+      m_membershipFlush.Cancel ();
+      m_membershipLog.clear ();
+      m_pimMembership.Clear ();
+      for (std::map<std::pair<Ipv4Address, uint32_t>, EventId>::iterator iter = m_routerRefresh.begin ();
+          iter != m_routerRefresh.end (); iter++)
+        {
+          iter->second.Cancel ();
+        }
+      m_routerRefresh.clear ();
       Ipv4RoutingProtocol::DoDispose ();
     }
 
@@ -312,6 +871,11 @@ namespace ns3
     void
     IGMPXRoutingProtocol::DoStart ()
     {
+      if (m_role == ROUTER && m_queryMode && !m_queryEvent.IsRunning ())
+        {
+          m_queryEvent = Simulator::Schedule (TransmissionDelay (0, m_queryResponseInterval.GetMilliSeconds (), Time::MS),
+              &IGMPXRoutingProtocol::SendGeneralQuery, this);
+        }
       #ifdef IGMPTEST
         return;
       #endif
@@ -349,24 +913,10 @@ namespace ns3
     IGMPXRoutingProtocol::SendPacketIGMPXBroadcast (Ptr<Packet> packet, const IGMPXHeader &message, int32_t interface)
     {
       NS_LOG_FUNCTION (this);
-      if (m_stopTx)
+      if (interface < 0 || (uint32_t) interface >= m_interfaceSockets.size ())
         return;
       packet->AddHeader (message);
-      for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator i = m_socketAddresses.begin ();
-          i != m_socketAddresses.end (); i++)
-        {
-          if (m_ipv4->GetInterfaceForDevice (i->first->GetBoundNetDevice ()) == interface)
-            {
-              Ipv4Address bcast = i->second.GetLocal ().GetSubnetDirectedBroadcast (i->second.GetMask ());
-              Ipv4Header ipv4header = BuildHeader (GetLocalAddress (interface), bcast, IGMPX_IP_PROTOCOL_NUM,
-                  packet->GetSize (), 1, false);
-              packet->AddHeader (ipv4header);
-              NS_LOG_DEBUG ("Node " << GetLocalAddress (interface) << " is sending to " << bcast << ":" << IGMPX_PORT_NUM << ", Socket " << i->first);
-              m_txControlPacketTrace (packet);
-              i->first->SendTo (packet, 0, InetSocketAddress (bcast, IGMPX_PORT_NUM));
-              break;
-            }
-        }
+      SendPacketIGMPX (packet, interface, m_interfaceSockets[interface].broadcast);
     }
 
     void
@@ -374,22 +924,107 @@ namespace ns3
                                                   Ipv4Address destination)
     {
       NS_LOG_FUNCTION (this);
+      packet->AddHeader (message);
+      SendPacketIGMPX (packet, interface, destination);
+    }
+
+    void
+    IGMPXRoutingProtocol::SendPacketIGMPX (Ptr<Packet> packet, int32_t interface, Ipv4Address destination)
+    {
+      NS_LOG_FUNCTION (this << interface << destination);
       if (m_stopTx)
         return;
-      packet->AddHeader (message);
-      for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator i = m_socketAddresses.begin ();
-          i != m_socketAddresses.end (); i++)
+      if (interface < 0 || (uint32_t) interface >= m_interfaceSockets.size () || m_interfaceSockets[interface].socket == 0)
         {
-          if (m_ipv4->GetInterfaceForDevice (i->first->GetBoundNetDevice ()) == interface)
-            {
-              Ipv4Header ipv4header = BuildHeader (GetLocalAddress (interface), destination, IGMPX_IP_PROTOCOL_NUM,
-                  packet->GetSize (), 1, false);
-              packet->AddHeader (ipv4header);
-              NS_LOG_DEBUG ("Node " << GetLocalAddress (interface) << " is sending to " << destination << ":" << IGMPX_PORT_NUM << ", Socket " << i->first);
-              m_txControlPacketTrace (packet);
-              i->first->SendTo (packet, 0, InetSocketAddress (destination, IGMPX_PORT_NUM));
-              break;
-            }
+          NS_LOG_DEBUG ("No socket on interface " << interface);
+          return;
+        }
+      const InterfaceSocket &entry = m_interfaceSockets[interface];
+      Ipv4Header ipv4header = BuildHeader (entry.local, destination, IGMPX_IP_PROTOCOL_NUM,
+          packet->GetSize (), 1, false);
+      packet->AddHeader (ipv4header);
+      NS_LOG_DEBUG ("Node " << entry.local << " is sending to " << destination << ":" << IGMPX_PORT_NUM << ", Socket " << entry.socket);
+      if (destination != entry.broadcast)
+        {
+          m_unicastTxPackets++;
+          m_savedAirtime += Seconds (m_broadcastRate.CalculateTxTime (packet->GetSize ()))
+              - Seconds (m_unicastRate.CalculateTxTime (packet->GetSize ()));
+        }
+      m_txControlPacketTrace (packet);
+      entry.socket->SendTo (packet, 0, InetSocketAddress (destination, IGMPX_PORT_NUM));
+    }
+
+    void
+    IGMPXRoutingProtocol::EnqueueIGMPX (const IGMPXHeader &message, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      if (m_txQueueWindow.IsZero ())
+        {
+          Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendPacketIGMPXBroadcast, this,
+              Create<Packet> (), message, interface);
+          return;
+        }
+      AppendTxQueue (message, interface);
+      ArmTxQueue (interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::AppendTxQueue (const IGMPXHeader &message, uint32_t interface)
+    {
+      TxQueue &queue = m_txQueues[interface];
+      uint32_t size = message.GetSerializedSize ();
+      if (!queue.messages.empty () && queue.bytes + size > m_maxPduSize)
+        {
+          // The message does not fit: the queue leaves now, the message opens a new one.
+          SendTxQueue (interface);
+        }
+      queue.messages.push_back (message);
+      queue.bytes += size;
+    }
+
+    void
+    IGMPXRoutingProtocol::ArmTxQueue (uint32_t interface)
+    {
+      TxQueue &queue = m_txQueues[interface];
+      if (!queue.flush.IsRunning ())
+        {
+          // The random delay desynchronizes the nodes reacting to the same message.
+          queue.flush = Simulator::Schedule (TransmissionDelay (0, m_txQueueWindow.GetMilliSeconds (), Time::MS),
+              &IGMPXRoutingProtocol::FlushTxQueue, this, interface);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::FlushTxQueue (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      // The pending reports and accepts join the queue only now, so that they are packed with the latest records.
+      FlushIgmpReports (interface);
+      FlushIgmpAccepts (interface);
+      SendTxQueue (interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::SendTxQueue (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      std::map<uint32_t, TxQueue>::iterator queue = m_txQueues.find (interface);
+      if (queue == m_txQueues.end () || queue->second.messages.empty ())
+        return;
+      Ptr<Packet> packet = Create<Packet> ();
+      // Headers are prepended: add them backwards to keep the queue order.
+      for (std::vector<IGMPXHeader>::reverse_iterator iter = queue->second.messages.rbegin ();
+          iter != queue->second.messages.rend (); iter++)
+        {
+          packet->AddHeader (*iter);
+        }
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " sends " << queue->second.messages.size () << " messages, "
+          << queue->second.bytes << " bytes on interface " << interface);
+      queue->second.messages.clear ();
+      queue->second.bytes = 0;
+      if (interface < m_interfaceSockets.size ())
+        {
+          SendPacketIGMPX (packet, interface, m_interfaceSockets[interface].broadcast);
         }
     }
 
@@ -398,14 +1033,42 @@ namespace ns3
     {
       NS_LOG_FUNCTION (this << sgp << interface << GetLocalAddress (interface));
       NS_ASSERT (m_role == CLIENT);
-      NS_ASSERT (m_igmpGroups.find (sgp) != m_igmpGroups.end ());
-      NS_ASSERT (m_igmpGroups.find (sgp)->second.igmpReport.find(interface) != m_igmpGroups.find (sgp)->second.igmpReport.end ());
-      Ipv4Address destination = m_igmpGroups.find(sgp)->second.igmpPair.nextMulticastAddr;
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      // The first report is scheduled on the simulator: the interface may be unregistered meanwhile.
+      if (state == 0 || state->igmpReport.find (interface) == state->igmpReport.end ())
+        return;
+      Ipv4Address destination = state->igmpPair.nextMulticastAddr;
       NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " sends reports router "<< destination);
       if (destination == Ipv4Address::GetAny())
         NS_LOG_INFO ("NOT ASSOCIATED!!");
+      if (m_queryMode)
+        {
+          // One answer, not periodic: a register keeps the router, a discovery report looks for one.
+          if (destination != Ipv4Address::GetAny () && state->igmpPair.snrNext >= IGMP_SNR_THRESHOLD)
+            SendIgmpReportNode (sgp, interface, destination);
+          else
+            SendIgmpReport (sgp, interface);
+          return;
+        }
       SendIgmpReport (sgp, interface);
-      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Schedule ();
+      state->igmpReport.find (interface)->second.Schedule ();
+      if (!m_reportAggregation)
+        return;
+      // Reports due within half a period on this interface ride along with this one.
+      for (uint32_t i = 0; i < m_igmpGroups.Size (); i++)
+        {
+          IgmpState *other = m_igmpGroups.Get (i);
+          std::map<uint32_t, IgmpTimer>::iterator report = other->igmpReport.find (interface);
+          if (other == state || report == other->igmpReport.end () || !report->second.IsRunning ())
+            continue;
+          if (report->second.GetDelayLeft () <= Seconds (IGMP_TIME / 2.0))
+            {
+              report->second.Cancel ();
+              SendIgmpReport (SourceGroupPair (other->igmpPair.sourceMulticastAddr, other->igmpPair.groupMulticastAddr),
+                  interface);
+              report->second.Schedule ();
+            }
+        }
     }
 
     void
@@ -413,16 +1076,19 @@ namespace ns3
     {
       NS_LOG_FUNCTION (this << sgp << GetLocalAddress (interface) << interface);
       NS_ASSERT (m_role == CLIENT);
-      Ptr<Packet> packet = Create<Packet> ();
       IGMPXHeader report (IGMPX_REPORT);
       IGMPXHeader::IgmpReportMessage &igmpReport = report.GetIgmpReportMessage ();
       igmpReport.m_multicastGroupAddr = sgp.groupMulticastAddr;
       igmpReport.m_sourceAddr = sgp.sourceMulticastAddr;
       // Setting the upstream address to any means the client is looking for a router to which associate.
       igmpReport.m_upstreamAddr = Ipv4Address::GetAny ();
-      Time delay = TransmissionDelay ();
       NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " SendIgmpReport for "<< sgp << " Interface " << interface);
-      Simulator::Schedule (delay, &IGMPXRoutingProtocol::SendPacketIGMPXBroadcast, this, packet, report, interface);
+      if (m_reportAggregation)
+        {
+          QueueIgmpReport (igmpReport, interface);
+          return;
+        }
+      EnqueueIGMPX (report, interface);
     }
 
     void
@@ -430,16 +1096,26 @@ namespace ns3
     {
       NS_LOG_FUNCTION (this << sgp << GetLocalAddress (interface) << interface << destination);
       NS_ASSERT (m_role == CLIENT);
-      Ptr<Packet> packet = Create<Packet> ();
       IGMPXHeader report (IGMPX_REPORT);
       IGMPXHeader::IgmpReportMessage &igmpReport = report.GetIgmpReportMessage ();
       igmpReport.m_multicastGroupAddr = sgp.groupMulticastAddr;
       igmpReport.m_sourceAddr = sgp.sourceMulticastAddr;
       igmpReport.m_upstreamAddr = destination;
-      Time delay = TransmissionDelay();
-      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " becomes client of " << destination << " (" << m_igmpGroups.find (sgp)->second.igmpPair.snrNext << ") for "<< sgp);
-      Simulator::Schedule(TransmissionDelay(), &IGMPXRoutingProtocol::SendPacketIGMPXBroadcast, this, packet, report,
-          interface);
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " becomes client of " << destination << " (" << m_igmpGroups.Find (PackSourceGroup (sgp))->igmpPair.snrNext << ") for "<< sgp);
+      if (m_txPolicy == TX_UNICAST_ASSOCIATED)
+        {
+          // The router is known: the register goes to it alone.
+          Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendPacketIGMPXUnicast, this,
+              Create<Packet> (), report, interface, destination);
+        }
+      else if (m_reportAggregation)
+        {
+          QueueIgmpReport (igmpReport, interface);
+        }
+      else
+        {
+          EnqueueIGMPX (report, interface);
+        }
 #ifndef IGMPTEST
       video->SetGateway (destination);
 #endif
@@ -450,7 +1126,10 @@ namespace ns3
     {
       NS_LOG_FUNCTION (this << sgp << interface);NS_LOG_INFO (sgp << "," << interface << "," << GetLocalAddress (interface));
       NS_ASSERT(m_role == CLIENT);
-      Ipv4Address destination = m_igmpGroups.find(sgp)->second.igmpPair.nextMulticastAddr;
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      if (state == 0 || state->igmpReport.find (interface) == state->igmpReport.end ())
+        return; // unregistered meanwhile
+      Ipv4Address destination = state->igmpPair.nextMulticastAddr;
       if (destination != Ipv4Address::GetAny())
         {
           SendIgmpReportNode(sgp, interface, destination);
@@ -461,10 +1140,148 @@ namespace ns3
           NS_LOG_DEBUG ("Client " << GetLocalAddress (interface) << " has no associated Router: looking for new candidate");
           NS_ASSERT(destination == Ipv4Address::GetAny());
         }
-      NS_LOG_INFO ("Node "<< GetLocalAddress (interface) <<" Reschedule validity of router " << destination << " at " << m_igmpGroups.find(sgp)->second.igmpPair.m_renew.GetDelay().GetSeconds());
-      if (m_igmpGroups.find(sgp)->second.igmpPair.m_renew.IsRunning())
-        m_igmpGroups.find(sgp)->second.igmpPair.m_renew.Cancel();
-      m_igmpGroups.find(sgp)->second.igmpPair.m_renew.Schedule ();
+      state->igmpRefreshHeard = false;
+      // In query mode the answers to the queries renew the association.
+      if (destination != Ipv4Address::GetAny () && !m_queryMode)
+        StartRefresh (destination, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::StartRefresh (Ipv4Address router, uint32_t interface)
+    {
+      EventId &refresh = m_routerRefresh[std::make_pair (router, interface)];
+      if (refresh.IsRunning ())
+        return;
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " starts the refresh of router " << router);
+      refresh = Simulator::Schedule (TransmissionDelay (IGMP_RENEW * 900, IGMP_RENEW * 1100, Time::MS),
+          &IGMPXRoutingProtocol::RefreshRouter, this, router, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::RefreshRouter (Ipv4Address router, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << router << interface);
+      NS_ASSERT (m_role == CLIENT);
+      std::vector<IGMPXHeader::IgmpReportMessage> records;
+      bool associated = false;
+      for (uint32_t i = 0; i < m_igmpGroups.Size (); i++)
+        {
+          IgmpState *state = m_igmpGroups.Get (i);
+          if (state->igmpPair.nextMulticastAddr != router || state->igmpReport.find (interface) == state->igmpReport.end ())
+            continue;
+          associated = true;
+          if (state->igmpRefreshHeard)
+            {
+              state->igmpRefreshHeard = false; // another client refreshed it this round
+              continue;
+            }
+          IGMPXHeader::IgmpReportMessage record;
+          record.m_multicastGroupAddr = state->igmpPair.groupMulticastAddr;
+          record.m_sourceAddr = state->igmpPair.sourceMulticastAddr;
+          record.m_upstreamAddr = router;
+          records.push_back (record);
+        }
+      if (!associated)
+        {
+          NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " stops the refresh of router " << router);
+          m_routerRefresh.erase (std::make_pair (router, interface));
+          return;
+        }
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " refreshes " << records.size () << " pairs with router " << router);
+      for (uint32_t first = 0; first < records.size (); first += IGMPX_MAX_RECORDS)
+        {
+          uint32_t last = std::min<uint32_t> (first + IGMPX_MAX_RECORDS, records.size ());
+          IGMPXHeader report (last - first == 1 ? IGMPX_REPORT : IGMPX_REPORT_MULTI);
+          if (last - first == 1)
+            report.GetIgmpReportMessage () = records[first];
+          else
+            report.GetIgmpMultiReportMessage ().m_records.assign (records.begin () + first, records.begin () + last);
+          if (m_txPolicy == TX_UNICAST_ASSOCIATED)
+            Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendPacketIGMPXUnicast, this,
+                Create<Packet> (), report, interface, router);
+          else
+            EnqueueIGMPX (report, interface);
+        }
+      m_routerRefresh[std::make_pair (router, interface)] = Simulator::Schedule (
+          TransmissionDelay (IGMP_RENEW * 900, IGMP_RENEW * 1100, Time::MS), &IGMPXRoutingProtocol::RefreshRouter, this,
+          router, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::QueueIgmpReport (const IGMPXHeader::IgmpReportMessage &record, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      NS_ASSERT (m_role == CLIENT);
+      std::vector<IGMPXHeader::IgmpReportMessage> &pending = m_pendingReports[interface];
+      std::vector<IGMPXHeader::IgmpReportMessage>::iterator iter = pending.begin ();
+      for (; iter != pending.end (); iter++)
+        {
+          if (iter->m_multicastGroupAddr == record.m_multicastGroupAddr && iter->m_sourceAddr == record.m_sourceAddr
+              && (iter->m_upstreamAddr == Ipv4Address::GetAny ()) == (record.m_upstreamAddr == Ipv4Address::GetAny ()))
+            break;
+        }
+      if (iter != pending.end ())
+        *iter = record; // the latest register replaces the pending one
+      else
+        pending.push_back (record);
+      if (!m_txQueueWindow.IsZero ())
+        {
+          // The reports leave with the interface queue.
+          ArmTxQueue (interface);
+        }
+      else if (!m_reportFlush[interface].IsRunning ())
+        {
+          m_reportFlush[interface] = Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::FlushIgmpReports,
+              this, interface);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::DropPendingReports (SourceGroupPair sgp, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface);
+      std::map<uint32_t, std::vector<IGMPXHeader::IgmpReportMessage> >::iterator pending = m_pendingReports.find (interface);
+      if (pending == m_pendingReports.end ())
+        return;
+      std::vector<IGMPXHeader::IgmpReportMessage>::iterator iter = pending->second.begin ();
+      while (iter != pending->second.end ())
+        {
+          if (iter->m_multicastGroupAddr == sgp.groupMulticastAddr && iter->m_sourceAddr == sgp.sourceMulticastAddr)
+            iter = pending->second.erase (iter);
+          else
+            iter++;
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::FlushIgmpReports (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      std::map<uint32_t, std::vector<IGMPXHeader::IgmpReportMessage> >::iterator pending = m_pendingReports.find (interface);
+      if (pending == m_pendingReports.end () || pending->second.empty ())
+        return;
+      std::vector<IGMPXHeader::IgmpReportMessage> records;
+      records.swap (pending->second);
+      NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " sends " << records.size () << " reports on interface " << interface);
+      for (uint32_t first = 0; first < records.size (); first += IGMPX_MAX_RECORDS)
+        {
+          uint32_t last = std::min<uint32_t> (first + IGMPX_MAX_RECORDS, records.size ());
+          IGMPXHeader report (last - first == 1 ? IGMPX_REPORT : IGMPX_REPORT_MULTI);
+          if (last - first == 1)
+            {
+              // A single report keeps the plain format.
+              report.GetIgmpReportMessage () = records[first];
+            }
+          else
+            {
+              IGMPXHeader::IgmpMultiReportMessage &multiReport = report.GetIgmpMultiReportMessage ();
+              multiReport.m_records.assign (records.begin () + first, records.begin () + last);
+            }
+          if (m_txQueueWindow.IsZero ())
+            SendPacketIGMPXBroadcast (Create<Packet> (), report, interface);
+          else
+            AppendTxQueue (report, interface);
+        }
     }
 
     void
@@ -475,6 +1292,9 @@ namespace ns3
         {
         case CLIENT:
           {
+            // The router accept is broadcast and heard by all its clients: not so with unicast accepts.
+            if ((m_queryMode || m_reportSuppression) && m_txPolicy == TX_BROADCAST && !IsMyOwnAddress (sender))
+              SuppressIgmpReport (report, interface);
             break;
           }
         case ROUTER:
@@ -494,35 +1314,41 @@ namespace ns3
               }
             else if (IsMyOwnAddress (report.m_upstreamAddr))
               { // The client provides the ROUTER address to register
-                if (m_igmpGroups.find (sgp) == m_igmpGroups.end ())
+                AddGroupSource (source, group);
+                IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+                if (state == 0)
                   { //add group
-                    m_igmpGroups.insert (std::pair<SourceGroupPair, IgmpState> (sgp, IgmpState (sgp)));
+                    state = m_igmpGroups.Insert (PackSourceGroup (sgp), IgmpState (sgp, &m_timerWheel));
                     NS_LOG_INFO ("Adding Source-Group (" << source << "," << group << ") to the map for " << sender << ".");
                   }
-                if (m_igmpGroups.find (sgp)->second.igmpReport.find (interface)
-                    == m_igmpGroups.find (sgp)->second.igmpReport.end ())
+                std::map<uint32_t, IgmpTimer>::iterator clients = state->igmpReport.find (interface);
+                if (clients == state->igmpReport.end ())
                   {
                     /*
                      * The router didn't have any client on the interface.
                      * Now, there is a client, thus the corresponding interface is added.
                      * Note that the routers use the Timer to clean the clients list.
                      */
-                    m_igmpGroups.find (sgp)->second.igmpReport.insert (std::pair<uint32_t, Timer> (interface, Timer (Timer::CANCEL_ON_DESTROY)));
-                    m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetFunction (&IGMPXRoutingProtocol::RemoveClients, this);
-                    m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetArguments (sgp, interface);
-                    m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.SetDelay (Seconds (IGMP_TIMEOUT));
+                    clients = state->igmpReport.insert (std::pair<uint32_t, IgmpTimer> (interface, IgmpTimer (&m_timerWheel))).first;
+                    clients->second.SetFunction (&IGMPXRoutingProtocol::ClientsTimerExpire, this);
+                    clients->second.SetArguments (sgp, interface);
+                    clients->second.SetDelay (Seconds (IGMP_TIMEOUT));
                     NS_LOG_INFO ("Adding Interface " << interface << " to the map and set clean timer ");
-                    #ifndef IGMPTEST // TEST FILES SHOULD NOT RUN THIS COMMAND
-                    //TODO: improve the registration.
-                    pimdm->registerMember (source, group, interface);
-                    #endif
+                    ChangeMembership (sgp, interface, true);
                   }
                 NS_LOG_INFO ("Receiving report from " << sender <<" ("<<snr<< "): Router "<<GetLocalAddress (interface) << " has " << sender << " as member for " << sgp);
                 //Note that the routers use the Timer to clean the clients list.
-                if (m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.IsRunning ())
-                  m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Cancel ();
-                m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Schedule ();
-                SendIgmpAccept (sgp, interface, sender);
+                //With lazy expiry a running timer is left alone, it checks the last report when it fires.
+                state->igmpLastSeen[interface] = Simulator::Now ();
+                ClientSet &members = state->igmpClients[interface];
+                if (members.Refresh (sender, Simulator::Now ()))
+                  m_membershipTrace (source, group, interface, members.Size ());
+                if (!m_lazyClientExpiry || !clients->second.IsRunning ())
+                  clients->second.Schedule ();
+                if (m_txPolicy == TX_UNICAST_ASSOCIATED)
+                  SendIgmpAcceptNode (sgp, interface, sender);
+                else
+                  SendIgmpAccept (sgp, interface, sender);
               }
             else
               {
@@ -538,20 +1364,176 @@ namespace ns3
         }
     }
 
+    void
+    IGMPXRoutingProtocol::SuppressIgmpReport (const IGMPXHeader::IgmpReportMessage &report, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      NS_ASSERT (m_role == CLIENT);
+      SourceGroupPair sgp (report.m_sourceAddr, report.m_multicastGroupAddr);
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      if (state == 0)
+        return;
+      std::map<uint32_t, IgmpTimer>::iterator timer = state->igmpReport.find (interface);
+      if (timer == state->igmpReport.end ())
+        return;
+      bool discovery = (report.m_upstreamAddr == Ipv4Address::GetAny ());
+      if (!discovery && report.m_upstreamAddr != state->igmpPair.nextMulticastAddr)
+        return; // a register to another router
+      if (m_queryMode && discovery)
+        return; // only the answers to the router are suppressed
+      bool suppressed = false;
+      std::map<uint32_t, std::vector<IGMPXHeader::IgmpReportMessage> >::iterator pending = m_pendingReports.find (interface);
+      if (pending != m_pendingReports.end ())
+        {
+          for (std::vector<IGMPXHeader::IgmpReportMessage>::iterator iter = pending->second.begin ();
+              iter != pending->second.end (); iter++)
+            {
+              if (iter->m_multicastGroupAddr == report.m_multicastGroupAddr && iter->m_sourceAddr == report.m_sourceAddr
+                  && iter->m_upstreamAddr == report.m_upstreamAddr)
+                {
+                  pending->second.erase (iter);
+                  suppressed = true;
+                  break;
+                }
+            }
+        }
+      if (m_queryMode)
+        {
+          if (timer->second.IsRunning ())
+            {
+              timer->second.Cancel ();
+              suppressed = true;
+            }
+        }
+      else if (discovery)
+        {
+          // Skip this round: the timer starts over from the report heard.
+          if (timer->second.IsRunning ())
+            {
+              timer->second.Cancel ();
+              timer->second.Schedule ();
+              suppressed = true;
+            }
+        }
+      else if (!state->igmpRefreshHeard)
+        {
+          // The next refresh of the router leaves the pair out.
+          state->igmpRefreshHeard = true;
+          suppressed = true;
+        }
+      if (suppressed)
+        {
+          NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " suppresses its report for " << sgp << " to " << report.m_upstreamAddr);
+          m_suppressedReports++;
+        }
+    }
+
     void
     IGMPXRoutingProtocol::SendIgmpAccept (SourceGroupPair sgp, uint32_t interface, Ipv4Address clientIP)
     {
       NS_LOG_FUNCTION (this << sgp << interface << clientIP);
       NS_ASSERT (m_role == ROUTER);
-      Ptr<Packet> packet = Create<Packet> ();
       IGMPXHeader accept (IGMPX_ACCEPT);
       IGMPXHeader::IgmpAcceptMessage &igmpAccept = accept.GetIgmpAcceptMessage ();
       igmpAccept.m_multicastGroupAddr = sgp.groupMulticastAddr;
       igmpAccept.m_sourceAddr = sgp.sourceMulticastAddr;
       igmpAccept.m_downstreamAddr = clientIP;
-      Time delay = TransmissionDelay ();
-      NS_LOG_INFO ("Router " << GetLocalAddress (interface) << " accepts client " << clientIP << " delay " << delay.GetSeconds());
-      Simulator::Schedule (delay, &IGMPXRoutingProtocol::SendPacketIGMPXBroadcast, this, packet, accept, interface);
+      NS_LOG_INFO ("Router " << GetLocalAddress (interface) << " accepts client " << clientIP);
+      if (m_acceptAggregation)
+        {
+          QueueIgmpAccept (sgp, interface, clientIP);
+          return;
+        }
+      EnqueueIGMPX (accept, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::SendIgmpAcceptNode (SourceGroupPair sgp, uint32_t interface, Ipv4Address clientIP)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << clientIP);
+      NS_ASSERT (m_role == ROUTER);
+      IGMPXHeader accept (IGMPX_ACCEPT);
+      IGMPXHeader::IgmpAcceptMessage &igmpAccept = accept.GetIgmpAcceptMessage ();
+      igmpAccept.m_multicastGroupAddr = sgp.groupMulticastAddr;
+      igmpAccept.m_sourceAddr = sgp.sourceMulticastAddr;
+      igmpAccept.m_downstreamAddr = clientIP;
+      NS_LOG_INFO ("Router " << GetLocalAddress (interface) << " accepts associated client " << clientIP << " in unicast");
+      Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendPacketIGMPXUnicast, this, Create<Packet> (),
+          accept, interface, clientIP);
+    }
+
+    void
+    IGMPXRoutingProtocol::QueueIgmpAccept (SourceGroupPair sgp, uint32_t interface, Ipv4Address clientIP)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << clientIP);
+      NS_ASSERT (m_role == ROUTER);
+      std::vector<IGMPXHeader::IgmpMultiAcceptMessage> &pending = m_pendingAccepts[interface];
+      std::vector<IGMPXHeader::IgmpMultiAcceptMessage>::iterator iter = pending.begin ();
+      for (; iter != pending.end (); iter++)
+        {
+          if (iter->m_multicastGroupAddr == sgp.groupMulticastAddr && iter->m_sourceAddr == sgp.sourceMulticastAddr)
+            break;
+        }
+      if (iter == pending.end ())
+        {
+          IGMPXHeader::IgmpMultiAcceptMessage accept;
+          accept.m_multicastGroupAddr = sgp.groupMulticastAddr;
+          accept.m_sourceAddr = sgp.sourceMulticastAddr;
+          iter = pending.insert (pending.end (), accept);
+        }
+      if (std::find (iter->m_downstreamAddrs.begin (), iter->m_downstreamAddrs.end (), clientIP) == iter->m_downstreamAddrs.end ())
+        iter->m_downstreamAddrs.push_back (clientIP);
+      if (!m_txQueueWindow.IsZero ())
+        {
+          // The accepts leave with the interface queue.
+          ArmTxQueue (interface);
+        }
+      else if (!m_acceptFlush[interface].IsRunning ())
+        {
+          m_acceptFlush[interface] = Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::FlushIgmpAccepts,
+              this, interface);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::FlushIgmpAccepts (uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << interface);
+      std::map<uint32_t, std::vector<IGMPXHeader::IgmpMultiAcceptMessage> >::iterator pending = m_pendingAccepts.find (interface);
+      if (pending == m_pendingAccepts.end () || pending->second.empty ())
+        return;
+      std::vector<IGMPXHeader::IgmpMultiAcceptMessage> accepts;
+      accepts.swap (pending->second);
+      for (std::vector<IGMPXHeader::IgmpMultiAcceptMessage>::const_iterator iter = accepts.begin (); iter != accepts.end (); iter++)
+        {
+          const std::vector<Ipv4Address> &clients = iter->m_downstreamAddrs;
+          NS_LOG_INFO ("Router " << GetLocalAddress (interface) << " accepts " << clients.size () << " clients for ("
+              << iter->m_sourceAddr << "," << iter->m_multicastGroupAddr << ") on interface " << interface);
+          for (uint32_t first = 0; first < clients.size (); first += IGMPX_MAX_RECORDS)
+            {
+              uint32_t last = std::min<uint32_t> (first + IGMPX_MAX_RECORDS, clients.size ());
+              IGMPXHeader accept (last - first == 1 ? IGMPX_ACCEPT : IGMPX_ACCEPT_MULTI);
+              if (last - first == 1)
+                {
+                  // A single client keeps the plain format.
+                  IGMPXHeader::IgmpAcceptMessage &igmpAccept = accept.GetIgmpAcceptMessage ();
+                  igmpAccept.m_multicastGroupAddr = iter->m_multicastGroupAddr;
+                  igmpAccept.m_sourceAddr = iter->m_sourceAddr;
+                  igmpAccept.m_downstreamAddr = clients[first];
+                }
+              else
+                {
+                  IGMPXHeader::IgmpMultiAcceptMessage &multiAccept = accept.GetIgmpMultiAcceptMessage ();
+                  multiAccept.m_multicastGroupAddr = iter->m_multicastGroupAddr;
+                  multiAccept.m_sourceAddr = iter->m_sourceAddr;
+                  multiAccept.m_downstreamAddrs.assign (clients.begin () + first, clients.begin () + last);
+                }
+              if (m_txQueueWindow.IsZero ())
+                SendPacketIGMPXBroadcast (Create<Packet> (), accept, interface);
+              else
+                AppendTxQueue (accept, interface);
+            }
+        }
     }
 
     void
@@ -571,39 +1553,47 @@ namespace ns3
             downstream = accept.m_downstreamAddr; //same subnet
             SourceGroupPair sgp (source, group);
             NS_LOG_INFO ("Node " << sender << " accepts " << receiver << " for " << sgp);
-            if (m_igmpGroups.find (sgp) == m_igmpGroups.end ())
+            IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+            if (state == 0)
               {
                 NS_LOG_DEBUG ("Client " << receiver << " receives accept: SKIP because is not interested in "<<sgp);
                 return;//not interested in the group
               }
-            Ipv4Address router = m_igmpGroups.find (sgp)->second.igmpPair.nextMulticastAddr;
-            double rsnr = m_igmpGroups.find (sgp)->second.igmpPair.snrNext;
+            if (state->igmpReport.find (interface) == state->igmpReport.end ())
+              {
+                NS_LOG_DEBUG ("Client " << receiver << " receives accept: SKIP because " << sgp << " is not registered on interface " << interface);
+                return;
+              }
+            Ipv4Address router = state->igmpPair.nextMulticastAddr;
+            double rsnr = state->igmpPair.snrNext;
+            double sample = snr;
+            snr = SmoothSnr (state, sender, sample);
             if (sender == router)
               {
                 /*
                  * Receive an accept from the associated router.
                  * The client updates the SNR, if lower than threshold, restart the association process.
                  */
-                if (m_igmpGroups.find (sgp)->second.igmpLife.IsRunning ()) //cancel old timer
-                  m_igmpGroups.find (sgp)->second.igmpLife.Cancel ();
-                m_igmpGroups.find (sgp)->second.igmpLife.Schedule ();
+                if (state->igmpLife.IsRunning ()) //cancel old timer
+                  state->igmpLife.Cancel ();
+                state->igmpLife.Schedule ();
                 NS_LOG_DEBUG ("Client " << receiver << " receives accept: UPDATE " << router << " (" << rsnr << ") to " << router << " (" << snr << ")");
-                m_igmpGroups.find (sgp)->second.igmpPair.snrNext = snr;
+                state->igmpPair.snrNext = snr;
+                if (sample < IGMP_SNR_THRESHOLD && snr >= IGMP_SNR_THRESHOLD)
+                  NS_LOG_DEBUG ("Client " << receiver << " receives accept: low SNR sample " << sample << " smoothed to " << snr);
+                CountAvoidedSwitch (state, sender, sample < IGMP_SNR_THRESHOLD && snr >= IGMP_SNR_THRESHOLD);
                 if (snr < IGMP_SNR_THRESHOLD) // if SNR lower threshold, restart report-accept-register process looking for new candidates
                   {
-                    if (m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.IsRunning ())
-                      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Cancel ();
-                    m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Schedule (Seconds(0));
+                    IgmpTimer &report = state->igmpReport.find (interface)->second;
+                    if (report.IsRunning ())
+                      report.Cancel ();
+                    report.Schedule (Seconds(0));
                     NS_LOG_DEBUG ("Client " << receiver << " receives accept: SNR too low, looking for a new candidate");
                   }
-                Time renew = TransmissionDelay(IGMP_RENEW * 900, IGMP_RENEW * 1100, Time::MS); //Multiple to millisecond
-                // Reschedule when the node will send a new register to this router
-                if (m_igmpGroups.find(sgp)->second.igmpPair.m_renew.IsRunning())
-                  m_igmpGroups.find(sgp)->second.igmpPair.m_renew.Cancel();
-                m_igmpGroups.find(sgp)->second.igmpPair.m_renew.Schedule(renew);
-                NS_LOG_INFO ("Node " << receiver << " reg. to "<<router<<": SAME ROUTER -> Renew in "<<renew.GetSeconds ()<<"ms");
+                NS_LOG_INFO ("Node " << receiver << " reg. to "<<router<<": SAME ROUTER");
               }
-            else if ( (rsnr / snr) < IGMP_SNR_RATIO)
+            else if ( (rsnr / snr) < IGMP_SNR_RATIO * (1 - m_snrHysteresis)
+                && (router == Ipv4Address::GetAny () || Simulator::Now () - state->igmpAssociation >= m_minDwellTime))
               {
                 /*
                  * Receive an accept from a different router router.
@@ -611,18 +1601,23 @@ namespace ns3
                  * change the associated router to the new one,
                  * sending an association message.
                  */
-                m_igmpGroups.find(sgp)->second.igmpPair.nextMulticastAddr = sender; // set this candidate
-                m_igmpGroups.find(sgp)->second.igmpPair.snrNext = snr; // set candidate's SNR
+                state->igmpPair.nextMulticastAddr = sender; // set this candidate
+                state->igmpPair.snrNext = snr; // set candidate's SNR
+                state->igmpAssociation = Simulator::Now ();
+                CountAvoidedSwitch (state, sender, false);
                 NS_LOG_DEBUG ("Client " << receiver << " receives accept: CHANGE router from " << router
                     << " (" << rsnr << ") -> to " << sender << " (" << snr << ")");
-                if (!m_regMsg.IsRunning())
+                // One pending register per pair: the pairs changing router together register in the same round.
+                if (!state->igmpRegister.IsRunning ())
                   {
-                    m_regMsg = Simulator::Schedule(TransmissionDelay(), &IGMPXRoutingProtocol::SendIgmpRegister, this,
-                        sgp, interface);
+                    state->igmpRegister = Simulator::Schedule (TransmissionDelay (), &IGMPXRoutingProtocol::SendIgmpRegister,
+                        this, sgp, interface);
                   }
               }
             else
               {
+                // The sample alone would have changed router.
+                CountAvoidedSwitch (state, sender, (rsnr / sample) < IGMP_SNR_RATIO);
                 NS_LOG_DEBUG ("Client " << receiver << " receives accept: LOWER router from "<< sender << " (" << snr << ") << of " << router << " (" << rsnr <<")");
               }
             break;
@@ -639,15 +1634,88 @@ namespace ns3
         }
     }
 
+    double
+    IGMPXRoutingProtocol::SmoothSnr (IgmpState *state, Ipv4Address router, double snr)
+    {
+      SnrEstimate &estimate = state->igmpRouterSnr[router];
+      // A router not heard for a whole timeout starts again from the sample.
+      if (estimate.last.IsZero () || Simulator::Now () - estimate.last > Seconds (IGMP_TIMEOUT))
+        estimate.value = snr;
+      else
+        estimate.value = m_snrAlpha * snr + (1 - m_snrAlpha) * estimate.value;
+      estimate.last = Simulator::Now ();
+      double value = estimate.value;
+      if (state->igmpRouterSnr.size () > m_routerCandidates)
+        {
+          std::map<Ipv4Address, SnrEstimate>::iterator weakest = state->igmpRouterSnr.end ();
+          for (std::map<Ipv4Address, SnrEstimate>::iterator iter = state->igmpRouterSnr.begin ();
+              iter != state->igmpRouterSnr.end (); iter++)
+            {
+              if (iter->first == state->igmpPair.nextMulticastAddr)
+                continue;
+              if (weakest == state->igmpRouterSnr.end () || iter->second.value < weakest->second.value)
+                weakest = iter;
+            }
+          state->igmpRouterSnr.erase (weakest);
+        }
+      return value;
+    }
+
+    void
+    IGMPXRoutingProtocol::CountAvoidedSwitch (IgmpState *state, Ipv4Address router, bool avoided)
+    {
+      // The weakest candidates are forgotten by SmoothSnr, and their episodes with them.
+      std::map<Ipv4Address, SnrEstimate>::iterator estimate = state->igmpRouterSnr.find (router);
+      if (estimate == state->igmpRouterSnr.end ())
+        return;
+      if (avoided && !estimate->second.avoided)
+        m_avoidedSwitches++;
+      estimate->second.avoided = avoided;
+    }
+
+    Ipv4Address
+    IGMPXRoutingProtocol::BestCandidate (IgmpState *state)
+    {
+      Ipv4Address best = Ipv4Address::GetAny ();
+      double bestSnr = 0;
+      for (std::map<Ipv4Address, SnrEstimate>::const_iterator iter = state->igmpRouterSnr.begin ();
+          iter != state->igmpRouterSnr.end (); iter++)
+        {
+          if (Simulator::Now () - iter->second.last > m_candidateLifetime)
+            continue;
+          if (best == Ipv4Address::GetAny () || iter->second.value > bestSnr)
+            {
+              best = iter->first;
+              bestSnr = iter->second.value;
+            }
+        }
+      return best;
+    }
+
     void
     IGMPXRoutingProtocol::RemoveRouter (SourceGroupPair sgp, uint32_t interface)
     {
       NS_LOG_FUNCTION (this << sgp << interface);
       NS_ASSERT(m_role == CLIENT);
       NS_ASSERT(interface >0 && interface<m_ipv4->GetNInterfaces ());
-      NS_LOG_INFO ("Remove router " << m_igmpGroups.find (sgp)->second.igmpPair.nextMulticastAddr << " for " << sgp);
-      m_igmpGroups.find(sgp)->second.igmpPair.nextMulticastAddr = Ipv4Address::GetAny();
-      m_igmpGroups.find(sgp)->second.igmpPair.snrNext = 0;
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      NS_ASSERT (state != 0);
+      NS_LOG_INFO ("Remove router " << state->igmpPair.nextMulticastAddr << " for " << sgp);
+      state->igmpRouterSnr.erase (state->igmpPair.nextMulticastAddr);
+      state->igmpPair.nextMulticastAddr = Ipv4Address::GetAny();
+      state->igmpPair.snrNext = 0;
+      Ipv4Address candidate = BestCandidate (state);
+      if (candidate != Ipv4Address::GetAny ())
+        {
+          // Fail over to the best router still heard, with no discovery round.
+          NS_LOG_INFO ("Fail over to candidate " << candidate << " for " << sgp);
+          state->igmpPair.nextMulticastAddr = candidate;
+          state->igmpPair.snrNext = state->igmpRouterSnr[candidate].value;
+          state->igmpAssociation = Simulator::Now ();
+          state->igmpLife.Schedule ();
+          Simulator::ScheduleNow (&IGMPXRoutingProtocol::SendIgmpRegister, this, sgp, interface);
+          return;
+        }
       Simulator::ScheduleNow(&IGMPXRoutingProtocol::SendIgmpReport, this, sgp, interface);
     }
 
@@ -656,69 +1724,257 @@ namespace ns3
     {
       NS_LOG_FUNCTION (this << sgp << interface);
       NS_ASSERT (m_role == ROUTER);
-      NS_ASSERT (m_igmpGroups.find (sgp) != m_igmpGroups.end ());
-      NS_ASSERT (m_igmpGroups.find (sgp)->second.igmpReport.find (interface) != m_igmpGroups.find (sgp)->second.igmpReport.end ());
-      int size = m_igmpGroups.find (sgp)->second.igmpReport.size ();
-      m_igmpGroups.find (sgp)->second.igmpReport.find (interface)->second.Cancel ();
-      m_igmpGroups.find (sgp)->second.igmpReport.erase (interface);
-      int size2 = m_igmpGroups.find (sgp)->second.igmpReport.size ();
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      NS_ASSERT (state != 0);
+      std::map<uint32_t, IgmpTimer>::iterator clients = state->igmpReport.find (interface);
+      NS_ASSERT (clients != state->igmpReport.end ());
+      int size = state->igmpReport.size ();
+      clients->second.Cancel ();
+      state->igmpReport.erase (clients);
+      state->igmpLastSeen.erase (interface);
+      std::map<uint32_t, ClientSet>::iterator members = state->igmpClients.find (interface);
+      if (members != state->igmpClients.end ())
+        {
+          if (!members->second.Empty ())
+            m_membershipTrace (sgp.sourceMulticastAddr, sgp.groupMulticastAddr, interface, 0);
+          state->igmpClients.erase (members);
+        }
+      int size2 = state->igmpReport.size ();
       NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " removes interface " << interface << " from " << size << " to " << size2);
-      if (m_igmpGroups.find (sgp)->second.igmpReport.empty ())
+      ChangeMembership (sgp, interface, false);
+      if (state->igmpReport.empty ())
         {
-          m_igmpGroups.erase (sgp);
+          m_igmpGroups.Erase (PackSourceGroup (sgp));
           NS_LOG_INFO ("Erase group " << sgp << " (" << size2 << ")" );
-          #ifndef IGMPTEST
-            pimdm->unregisterMember (sgp.sourceMulticastAddr, sgp.groupMulticastAddr, interface);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::ChangeMembership (SourceGroupPair sgp, uint32_t interface, bool member)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << member);
+      std::vector<PimMembership::Change> changes;
+      if (member)
+        m_pimMembership.Join (sgp.sourceMulticastAddr, sgp.groupMulticastAddr, interface, changes);
+      else
+        m_pimMembership.Leave (sgp.sourceMulticastAddr, sgp.groupMulticastAddr, interface, changes);
+      for (std::vector<PimMembership::Change>::const_iterator iter = changes.begin (); iter != changes.end (); iter++)
+        {
+          NotifyMembership (SourceGroupPair (iter->source, iter->group), iter->interface, iter->member);
+        }
+    }
+
+    void
+    IGMPXRoutingProtocol::NotifyMembership (SourceGroupPair sgp, uint32_t interface, bool member)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface << member);
+      NS_ASSERT (m_role == ROUTER);
+      if (m_membershipBatch.IsZero ())
+        {
+          m_membershipLog[std::make_pair (PackSourceGroup (sgp), interface)] = member;
+          FlushMembership ();
+          return;
+        }
+      std::pair<uint64_t, uint32_t> key (PackSourceGroup (sgp), interface);
+      std::map<std::pair<uint64_t, uint32_t>, bool>::iterator change = m_membershipLog.find (key);
+      if (change != m_membershipLog.end ())
+        {
+          // Joins and leaves of an interface alternate: a logged change is always the opposite one.
+          NS_ASSERT (change->second != member);
+          NS_LOG_INFO ("Membership of " << sgp << " on interface " << interface << " flapped, PIM-DM is not notified");
+          m_membershipLog.erase (change);
+          return;
+        }
+      m_membershipLog[key] = member;
+      if (!m_membershipFlush.IsRunning ())
+        m_membershipFlush = Simulator::Schedule (m_membershipBatch, &IGMPXRoutingProtocol::FlushMembership, this);
+    }
+
+    void
+    IGMPXRoutingProtocol::FlushMembership ()
+    {
+      NS_LOG_FUNCTION (this << m_membershipLog.size ());
+      for (std::map<std::pair<uint64_t, uint32_t>, bool>::const_iterator iter = m_membershipLog.begin ();
+          iter != m_membershipLog.end (); iter++)
+        {
+          // The packed key holds the group in the upper half, the source in the lower one.
+          Ipv4Address source (static_cast<uint32_t> (iter->first.first));
+          Ipv4Address group (static_cast<uint32_t> (iter->first.first >> 32));
+          uint32_t interface = iter->first.second;
+          NS_LOG_INFO ("Membership of (" << source << "," << group << ") on interface " << interface << ": " << iter->second);
+          #ifndef IGMPTEST // TEST FILES SHOULD NOT RUN THIS COMMAND
+          if (iter->second)
+            pimdm->registerMember (source, group, interface);
+          else
+            pimdm->unregisterMember (source, group, interface);
           #endif
         }
+      m_membershipLog.clear ();
+    }
+
+    void
+    IGMPXRoutingProtocol::ClientsTimerExpire (SourceGroupPair sgp, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << sgp << interface);
+      NS_ASSERT (m_role == ROUTER);
+      IgmpState *state = m_igmpGroups.Find (PackSourceGroup (sgp));
+      NS_ASSERT (state != 0);
+      ExpireClients (state, interface);
+      if (m_lazyClientExpiry)
+        {
+          std::map<uint32_t, Time>::const_iterator seen = state->igmpLastSeen.find (interface);
+          if (seen != state->igmpLastSeen.end ())
+            {
+              Time deadline = seen->second + Seconds (IGMP_TIMEOUT);
+              if (deadline > Simulator::Now ())
+                {
+                  NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " clients of " << sgp << " refreshed, timeout at " << deadline.GetSeconds ());
+                  state->igmpReport.find (interface)->second.Schedule (deadline - Simulator::Now ());
+                  return;
+                }
+            }
+        }
+      RemoveClients (sgp, interface);
+    }
+
+    void
+    IGMPXRoutingProtocol::ExpireClients (IgmpState *state, uint32_t interface)
+    {
+      std::map<uint32_t, ClientSet>::iterator members = state->igmpClients.find (interface);
+      if (members == state->igmpClients.end ())
+        return;
+      if (members->second.Expire (Simulator::Now () - Seconds (IGMP_TIMEOUT)) > 0)
+        {
+          NS_LOG_INFO ("Node " << GetLocalAddress (interface) << " has " << members->second.Size () << " clients of " << state->igmpPair);
+          m_membershipTrace (state->igmpPair.sourceMulticastAddr, state->igmpPair.groupMulticastAddr, interface,
+              members->second.Size ());
+        }
     }
 
     void
     IGMPXRoutingProtocol::RecvIGMPX (Ptr<Socket> socket)
     {
       NS_LOG_FUNCTION (this);
+      // The interface of the socket is resolved once for all the packets queued.
+      std::map<Ptr<Socket>, uint32_t>::const_iterator found = m_socketInterfaces.find (socket);
+      NS_ASSERT (found != m_socketInterfaces.end ());
+      uint32_t interface = found->second;
+      Ipv4Address receiverIfaceAddr = m_interfaceSockets[interface].local;
+      NS_ASSERT (receiverIfaceAddr != Ipv4Address ());
       Ptr<Packet> receivedPacket;
       Address sourceAddress;
-      receivedPacket = socket->RecvFrom (sourceAddress);
-      InetSocketAddress inetSourceAddr = InetSocketAddress::ConvertFrom (sourceAddress);
-      Ipv4Address senderIfaceAddr = inetSourceAddr.GetIpv4 ();
-      int32_t interface = m_ipv4->GetInterfaceForDevice (socket->GetBoundNetDevice ());
-      NS_ASSERT (interface);
-      Ipv4Address receiverIfaceAddr = m_ipv4->GetAddress (interface, 0).GetLocal ();
-      NS_ASSERT (receiverIfaceAddr != Ipv4Address ());
-      m_rxControlPacketTrace (receivedPacket);
-      Ipv4Header ipv4header;
-      receivedPacket->RemoveHeader (ipv4header);
-      Ipv4Address subnet = ipv4header.GetDestination ();
-      Ipv4Address local = GetLocalAddress (interface);
-      NS_LOG_DEBUG ("Sender = " << senderIfaceAddr << " Receiver = " << receiverIfaceAddr << ", Subnet = " << subnet);
-      IGMPXHeader igmpxPacket;
-      receivedPacket->RemoveHeader (igmpxPacket);
-      switch (igmpxPacket.GetType ())
-        {
-        case IGMPX_REPORT:
-          {
-            SnrTag snrTag;
-            receivedPacket->RemovePacketTag (snrTag);
-            RecvIgmpReport (igmpxPacket.GetIgmpReportMessage (), senderIfaceAddr, receiverIfaceAddr, interface,
-                snrTag.GetSinr ());
-            break;
-          }
-        case IGMPX_ACCEPT:
-          {
-            if (m_role == ROUTER)
-              return;
-            SnrTag ptag;
-            receivedPacket->RemovePacketTag (ptag);
-            RecvIgmpAccept (igmpxPacket.GetIgmpAcceptMessage (), senderIfaceAddr, receiverIfaceAddr, interface,
-                ptag.GetSinr ());
-            break;
-          }
-        default:
-          {
-            NS_LOG_ERROR ("Packet unrecognized.... " << receivedPacket << "Sender " << senderIfaceAddr << ", Destination " << receiverIfaceAddr);
-            break;
-          }
+      while ((receivedPacket = socket->RecvFrom (sourceAddress)) != 0)
+        {
+          Ipv4Address senderIfaceAddr = InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ();
+          m_rxControlPacketTrace (receivedPacket);
+          // Only the sender address is needed from the IP header, which is dropped unparsed.
+          uint8_t versionIhl;
+          receivedPacket->CopyData (&versionIhl, 1);
+          receivedPacket->RemoveAtStart ((versionIhl & 0x0f) * 4);
+          NS_LOG_DEBUG ("Sender = " << senderIfaceAddr << " Receiver = " << receiverIfaceAddr);
+          RecvIGMPXPacket (receivedPacket, senderIfaceAddr, receiverIfaceAddr, interface);
+        }
+    }
+
+    bool
+    IGMPXRoutingProtocol::AcceptWanted (Ptr<Packet> packet)
+    {
+      // Type, reserved, checksum, then the accept group or the multi-accept count and group.
+      uint8_t buffer[12];
+      if (packet->CopyData (buffer, 12) < 12)
+        return true;
+      uint32_t groupOffset, size;
+      if (buffer[0] == IGMPX_ACCEPT)
+        {
+          groupOffset = 4;
+          size = 4 + 3 * IPV4_ADDRESS_SIZE;
+        }
+      else if (buffer[0] == IGMPX_ACCEPT_MULTI)
+        {
+          groupOffset = 8;
+          size = 4 + 4 + (2 + ((buffer[4] << 8) | buffer[5])) * IPV4_ADDRESS_SIZE;
+        }
+      else
+        return true;
+      Ipv4Address group = Ipv4Address::Deserialize (buffer + groupOffset);
+      if (m_groupFilter.MayContain (group))
+        return true;
+      NS_LOG_LOGIC ("Drop accept for group " << group);
+      packet->RemoveAtStart (size);
+      return false;
+    }
+
+    void
+    IGMPXRoutingProtocol::RecvIGMPXPacket (Ptr<Packet> receivedPacket, Ipv4Address senderIfaceAddr,
+                                           Ipv4Address receiverIfaceAddr, uint32_t interface)
+    {
+      NS_LOG_FUNCTION (this << senderIfaceAddr << interface);
+      // A packet carries one or more messages, all received with the same SNR.
+      SnrTag snrTag;
+      receivedPacket->RemovePacketTag (snrTag);
+      while (receivedPacket->GetSize () > 0)
+        {
+          if (m_role == CLIENT && !AcceptWanted (receivedPacket))
+            continue;
+          IGMPXHeader igmpxPacket;
+          receivedPacket->RemoveHeader (igmpxPacket);
+          switch (igmpxPacket.GetType ())
+            {
+            case IGMPX_REPORT:
+              {
+                RecvIgmpReport (igmpxPacket.GetIgmpReportMessage (), senderIfaceAddr, receiverIfaceAddr, interface,
+                    snrTag.GetSinr ());
+                break;
+              }
+            case IGMPX_REPORT_MULTI:
+              {
+                std::vector<IGMPXHeader::IgmpReportMessage> &records = igmpxPacket.GetIgmpMultiReportMessage ().m_records;
+                for (std::vector<IGMPXHeader::IgmpReportMessage>::iterator iter = records.begin (); iter != records.end (); iter++)
+                  {
+                    RecvIgmpReport (*iter, senderIfaceAddr, receiverIfaceAddr, interface, snrTag.GetSinr ());
+                  }
+                break;
+              }
+            case IGMPX_ACCEPT:
+              {
+                if (m_role == ROUTER)
+                  break;
+                RecvIgmpAccept (igmpxPacket.GetIgmpAcceptMessage (), senderIfaceAddr, receiverIfaceAddr, interface,
+                    snrTag.GetSinr ());
+                break;
+              }
+            case IGMPX_LEAVE:
+              {
+                RecvIgmpLeave (igmpxPacket.GetIgmpLeaveMessage (), senderIfaceAddr, receiverIfaceAddr, interface);
+                break;
+              }
+            case IGMPX_QUERY:
+              {
+                RecvIgmpQuery (igmpxPacket.GetIgmpQueryMessage (), senderIfaceAddr, receiverIfaceAddr, interface);
+                break;
+              }
+            case IGMPX_ACCEPT_MULTI:
+              {
+                if (m_role == ROUTER)
+                  break;
+                // Clients handle the accept once, as the one addressed to them if listed.
+                IGMPXHeader::IgmpMultiAcceptMessage &multiAccept = igmpxPacket.GetIgmpMultiAcceptMessage ();
+                IGMPXHeader::IgmpAcceptMessage accept;
+                accept.m_multicastGroupAddr = multiAccept.m_multicastGroupAddr;
+                accept.m_sourceAddr = multiAccept.m_sourceAddr;
+                accept.m_downstreamAddr = multiAccept.m_downstreamAddrs.empty () ? Ipv4Address::GetAny () : multiAccept.m_downstreamAddrs.front ();
+                if (std::find (multiAccept.m_downstreamAddrs.begin (), multiAccept.m_downstreamAddrs.end (), receiverIfaceAddr)
+                    != multiAccept.m_downstreamAddrs.end ())
+                  accept.m_downstreamAddr = receiverIfaceAddr;
+                RecvIgmpAccept (accept, senderIfaceAddr, receiverIfaceAddr, interface, snrTag.GetSinr ());
+                break;
+              }
+            default:
+              {
+                NS_LOG_ERROR ("Packet unrecognized.... " << receivedPacket << "Sender " << senderIfaceAddr << ", Destination " << receiverIfaceAddr);
+                return;
+              }
+            }
         }
     }
 
@@ -778,7 +2034,7 @@ namespace ns3
     Time
     IGMPXRoutingProtocol::TransmissionDelay (double l, double u, enum Time::Unit unit)
     {
-      double delay = UniformVariable ().GetValue (l, u);
+      double delay = m_uniformRandom->GetValue (l, u);
       Time delayms = Time::FromDouble (delay, unit);
       return delayms;
     }
@@ -25,8 +25,10 @@
 #define __IGMPX_ROUTING_H__
 
 #include "igmpx-packet.h"
+#include "igmpx-group-table.h"
+#include "igmpx-timer-wheel.h"
 #include <ns3/uinteger.h>
-#include <ns3/random-variable.h>
+#include <ns3/random-variable-stream.h>
 #include <ns3/object.h>
 #include <ns3/packet.h>
 #include <ns3/node.h>
@@ -40,6 +42,7 @@
 #include <ns3/ipv4-list-routing.h>
 #include <ns3/ipv4-l3-protocol.h>
 #include <ns3/string.h>
+#include <ns3/data-rate.h>
 #include <ns3/pimdm-routing.h>
 #include <ns3/video-push.h>
 #include <ns3/gnuplot.h>
@@ -70,21 +73,26 @@ namespace ns3
       CLIENT, ROUTER
     };
 
+    /// Transmission policy of the messages between associated clients and routers.
+    enum TxPolicy
+    {
+      TX_BROADCAST, ///< All the messages are broadcast.
+      TX_UNICAST_ASSOCIATED ///< Accepts to associated clients and renew reports to the router are unicast.
+    };
+
     struct SourceGroupPair
     {
         SourceGroupPair () :
             sourceMulticastAddr(Ipv4Address::GetAny()), groupMulticastAddr(Ipv4Address::GetAny()),
-            nextMulticastAddr(Ipv4Address::GetAny()), snrNext(0.0), m_renew(Timer::CANCEL_ON_DESTROY)
+            nextMulticastAddr(Ipv4Address::GetAny()), snrNext(0.0)
         {
         }
         SourceGroupPair (Ipv4Address s, Ipv4Address g) :
-            sourceMulticastAddr(s), groupMulticastAddr(g), nextMulticastAddr(Ipv4Address::GetAny()), snrNext(0.0),
-            m_renew(Timer::CANCEL_ON_DESTROY)
+            sourceMulticastAddr(s), groupMulticastAddr(g), nextMulticastAddr(Ipv4Address::GetAny()), snrNext(0.0)
         {
         }
         SourceGroupPair (Ipv4Address s, Ipv4Address g, Ipv4Address n) :
-            sourceMulticastAddr(s), groupMulticastAddr(g), nextMulticastAddr(n), snrNext(0.0),
-            m_renew(Timer::CANCEL_ON_DESTROY)
+            sourceMulticastAddr(s), groupMulticastAddr(g), nextMulticastAddr(n), snrNext(0.0)
         {
         }
         /// Multicast Source address.
@@ -95,8 +103,6 @@ namespace ns3
         Ipv4Address nextMulticastAddr;
         /// Router's SNR value.
         double snrNext;
-        /// Timer to renew subscription to the associated router.
-        Timer m_renew;
     };
 
     static inline bool
@@ -120,14 +126,35 @@ namespace ns3
       return os;
     }
 
+    /// Smoothed SNR of a router.
+    struct SnrEstimate
+    {
+        SnrEstimate () :
+            value(0.0), last(Seconds (0)), avoided(false)
+        {
+        }
+        double value; /// Exponentially weighted moving average of the SNR samples.
+        Time last; /// Time of the last sample.
+        bool avoided; /// The raw samples of the router call for a switch that was avoided, already counted.
+    };
+
+    /// Timer scheduled on the protocol TimerWheel, calling back with a Source-Group pair and an interface.
+    typedef WheelTimer<SourceGroupPair, uint32_t> IgmpTimer;
+
     struct IgmpState
     {
         SourceGroupPair igmpPair; /// SourceGroup pair.
-        std::map<uint32_t, Timer> igmpReport; /// <Interface, Timer > to: clients send the reports
-        Timer igmpLife; /// Client lifetime for this Source-Group Pair (called SGP) entry to some router.
+        std::map<uint32_t, IgmpTimer> igmpReport; /// <Interface, Timer > to: clients send the reports
+        IgmpTimer igmpLife; /// Client lifetime for this Source-Group Pair (called SGP) entry to some router.
+        bool igmpRefreshHeard; /// Another client refreshed the pair with the router since the last refresh, clients only.
+        std::map<uint32_t, Time> igmpLastSeen; /// <Interface, Time > of the last client report, routers with lazy expiry.
+        std::map<uint32_t, ClientSet> igmpClients; /// <Interface, Clients > heard within the timeout, routers only.
+        std::map<Ipv4Address, SnrEstimate> igmpRouterSnr; /// Smoothed SNR of the best routers heard, clients only.
+        Time igmpAssociation; /// Time of the last router change, clients only.
+        EventId igmpRegister; /// Register to the new router after a change, clients only.
 
-        IgmpState (SourceGroupPair sgp) :
-            igmpPair(sgp), igmpLife(Timer::CANCEL_ON_DESTROY)
+        IgmpState (SourceGroupPair sgp, TimerWheel *wheel = 0) :
+            igmpPair(sgp), igmpLife(wheel), igmpRefreshHeard(false), igmpAssociation(Seconds (0))
         {
           igmpReport.clear();
         }
@@ -143,12 +170,42 @@ namespace ns3
       return (a.igmpPair == b.igmpPair);
     }
 
+    static inline uint64_t
+    PackSourceGroup (const SourceGroupPair &sgp)
+    {
+      return PackSourceGroup (sgp.sourceMulticastAddr, sgp.groupMulticastAddr);
+    }
+
+    /// Transmission state of an interface, precomputed when its address is set.
+    struct InterfaceSocket
+    {
+        InterfaceSocket () :
+            socket(0), local(Ipv4Address::GetAny()), broadcast(Ipv4Address::GetBroadcast())
+        {
+        }
+        Ptr<Socket> socket; /// Raw socket bound to the interface device, 0 if none.
+        Ipv4Address local; /// Interface address.
+        Ipv4Address broadcast; /// Subnet directed broadcast address.
+    };
+
+    /// Broadcast messages waiting to be sent together on an interface.
+    struct TxQueue
+    {
+        TxQueue () :
+            bytes(0)
+        {
+        }
+        std::vector<IGMPXHeader> messages; /// Messages in transmission order.
+        uint32_t bytes; /// Serialized size of the messages.
+        EventId flush; /// Transmission of the queue.
+    };
+
     /**
      * \brief Define the IGMP-like protocol.
      *
      * Define the IGMP-like protocol as an Ipv4RoutingProtocol.
-     * Such a protocol runs on all the interfaces,
-     * the exclusion of several interface is not yet implemented.
+     * Such a protocol runs on all the interfaces but the loopback
+     * and those excluded with SetInterfaceExclusions.
      *
      * The clients have a set of source-group tuple
      * registered on each interface, meaning that they are
@@ -160,6 +217,14 @@ namespace ns3
      *   Source-Group pair on a given interface in broadcast,
      *   providing the Ip address of the upstream router,
      *   set to ANY if no routers are available.
+     *   The reports due on the same interface are packed into a single
+     *   multi-record report (see the ReportAggregation attribute).
+     *   Routers answer all the clients of a Source-Group pair heard on an interface
+     *   with a single accept listing them (see the AcceptAggregation attribute).
+     *   All the broadcast messages due on an interface within TxQueueWindow
+     *   are sent in the same packet, up to MaxPduSize bytes; the pending
+     *   reports and accepts join that packet when it leaves, with no delay of their own.
+     *   Unicast messages have a single receiver and leave on their own.
      *
      * - The ROUTER receive the message:
      *   - if ANY, replies with the accept for the Source-Group pair
@@ -169,11 +234,39 @@ namespace ns3
      *     finally, sends the accept message for that client;
      *   - if another address, SKIP.
      *
+     * - A source set to ANY stands for any source of the group, (*,G): the clients keep one
+     *   entry for the group, whatever the number of sources. The ROUTER registers the
+     *   interface with PIM-DM for every source of the group it knows, see AddGroupSource;
+     *   it also learns the sources of the (S,G) registers and of the multicast data it receives,
+     *   so that a (*,G) entry joined before its sources follows them as they appear.
+     *
+     * - The ROUTER tracks the clients registered per Source-Group pair and interface,
+     *   see GetClients and the MembershipCount trace source.
+     *
+     * - A CLIENT unregistering an interface sends a Leave to its router;
+     *   with no interface left, it forgets the Source-Group pair and its router.
+     *   If the router knows other clients there, it keeps the interface;
+     *   otherwise the other clients of the Source-Group pair hearing the leave register again,
+     *   and the router removes the interface if none does within LastMemberTime.
+     *
+     * - With QueryMode the ROUTER sends a general query every QueryInterval,
+     *   and a group-specific query after a leave. The CLIENT drops the periodic
+     *   reports and renews: it answers a query after a random delay, with a register
+     *   if associated, and cancels its answer on hearing a register of another
+     *   client for the same Source-Group pair and router.
+     *
+     * - With ReportSuppression a CLIENT hearing the report of another client
+     *   for the same Source-Group pair (and router, for a register) skips its own
+     *   pending report and restarts the timer: the broadcast accept of the router
+     *   reaches it anyway.
+     *
+     * - A CLIENT renews its association to a router with one register every IGMP_RENEW seconds,
+     *   per router and interface, listing all the Source-Group pairs associated to that router.
+     *
      * - A CLIENT receives the accept message:
      *   - the message is from the associated router for this client OR another client:
      *     - update router's lifetime and SNR;
      *     - check SNR level, if too low, the clients looks for a new router to associate.
-     *     - update the renew timer to send the report to the router.
      *
      *   - the message is NOT from the associated router:
      *     - if the SNR ratio between the associated router and this router is over the threshold
@@ -186,24 +279,69 @@ namespace ns3
       private:
         int32_t m_mainInterface; ///< Node main interface. Right now it runs on all interfaces
         Ipv4Address m_mainAddress; ///< Main address on the main interface.
-        std::map<SourceGroupPair, IgmpState> m_igmpGroups; ///< Map of SGP->State
+        TimerWheel m_timerWheel; ///< Wheel running all the IgmpState timers, it must outlive them.
+        SourceGroupTable<IgmpState> m_igmpGroups; ///< Table of SGP->State, indexed by PackSourceGroup
+        GroupFilter m_groupFilter; ///< Groups of m_igmpGroups, to drop the accepts of other groups unparsed.
         bool m_stopTx;
         Ptr<Ipv4> m_ipv4; ///< Node IP Protocol.
         uint32_t m_identification; ///< Identification counter for IPv4 header.
-        ///< Raw socket per each IP interface, map socket -> iface address (IP + mask)
-        std::map<Ptr<Socket>, Ipv4InterfaceAddress> m_socketAddresses;
+        std::vector<InterfaceSocket> m_interfaceSockets; ///< Socket, address and broadcast per interface index.
+        AddressTable m_localAddresses; ///< Address of each open socket -> its index in m_interfaceSockets.
+        std::map<Ptr<Socket>, uint32_t> m_socketInterfaces; ///< Open socket -> its index in m_interfaceSockets.
+        std::set<uint32_t> m_interfaceExclusions; ///< Interfaces not running the protocol.
+        /// Interface -> packed Source-Group pairs registered while the interface is excluded, clients only.
+        std::map<uint32_t, std::set<uint64_t> > m_excludedPairs;
         /// Pointer to socket.
         Ptr<Ipv4RoutingProtocol>* m_routingProtocol;
         /// Loopback device used to defer RREQ until packet will be fully formed
         Ptr<Ipv4StaticRouting> m_RoutingTable;
         Time m_startTime; ///< Node start time.
         Timer m_renew; ///< Node renew report timer.
-        EventId m_regMsg;
+        bool m_reportAggregation; ///< Coalesce the reports due on an interface into one packet.
+        bool m_lazyClientExpiry; ///< Routers refresh the client timeout with a timestamp, not a reschedule.
+        ///< Reports waiting to be sent, per interface.
+        std::map<uint32_t, std::vector<IGMPXHeader::IgmpReportMessage> > m_pendingReports;
+        std::map<uint32_t, EventId> m_reportFlush; ///< Transmission of the pending reports, per interface.
+        bool m_acceptAggregation; ///< Answer the clients of a Source-Group pair on an interface with one accept.
+        ///< Accepts waiting to be sent, per interface.
+        std::map<uint32_t, std::vector<IGMPXHeader::IgmpMultiAcceptMessage> > m_pendingAccepts;
+        std::map<uint32_t, EventId> m_acceptFlush; ///< Transmission of the pending accepts, per interface.
+        double m_snrAlpha; ///< Weight of a new SNR sample in the moving average, 1 to use the samples as they are.
+        double m_snrHysteresis; ///< Extra margin a candidate router needs over IGMP_SNR_RATIO.
+        Time m_minDwellTime; ///< Shortest time with the same router before changing it.
+        uint32_t m_avoidedSwitches; ///< Router changes and searches the raw SNR called for but the filter avoided, once per episode.
+        uint32_t m_routerCandidates; ///< Routers remembered per Source-Group pair.
+        Time m_candidateLifetime; ///< Age after which a silent router is no longer a candidate.
+        Time m_lastMemberTime; ///< Time the other clients have to answer a leave before the router prunes.
+        TxPolicy m_txPolicy; ///< Broadcast or unicast once associated.
+        DataRate m_broadcastRate; ///< Rate of the broadcast frames, to estimate the airtime saved.
+        DataRate m_unicastRate; ///< Rate of the unicast frames, to estimate the airtime saved.
+        uint32_t m_unicastTxPackets; ///< Packets sent in unicast.
+        Time m_savedAirtime; ///< Airtime saved by the packets sent in unicast instead of broadcast.
+        Time m_txQueueWindow; ///< Largest delay of a queued message, zero to send each message on its own.
+        uint32_t m_maxPduSize; ///< Largest size of the messages sent in one packet.
+        std::map<uint32_t, TxQueue> m_txQueues; ///< Outbound broadcast messages, per interface.
+        bool m_queryMode; ///< Routers query the clients, which report only to answer the queries.
+        Time m_queryInterval; ///< Period of the general queries.
+        Time m_queryResponseInterval; ///< Longest delay of the answer to a general query.
+        EventId m_queryEvent; ///< Next general query, routers in query mode.
+        bool m_reportSuppression; ///< Clients skip their report on hearing the same report from another client.
+        uint32_t m_suppressedReports; ///< Reports and registers not sent because another client sent them.
+        Time m_membershipBatch; ///< Period over which the membership changes are coalesced before PIM-DM hears them.
+        /// Membership changes not yet passed to PIM-DM: (packed Source-Group pair, interface) -> joined.
+        std::map<std::pair<uint64_t, uint32_t>, bool> m_membershipLog;
+        EventId m_membershipFlush; ///< Delivery of the membership changes to PIM-DM.
+        PimMembership m_pimMembership; ///< PIM-DM memberships out of the (S,G) and (*,G) entries, routers only.
+        /// (router, interface) -> next refresh of all the Source-Group pairs associated to the router, clients only.
+        std::map<std::pair<Ipv4Address, uint32_t>, EventId> m_routerRefresh;
+        Ptr<UniformRandomVariable> m_uniformRandom; ///< Source of the start time and of the transmission jitters.
         PeerRole m_role; ///< Node role.
         Ptr<pimdm::MulticastRoutingProtocol> pimdm;
         Ptr<VideoPushApplication> video;
         TracedCallback<Ptr<const Packet> > m_rxControlPacketTrace;
         TracedCallback<Ptr<const Packet> > m_txControlPacketTrace;
+        /// Source, group, interface and number of clients, on every change of the clients of a router.
+        TracedCallback<Ipv4Address, Ipv4Address, uint32_t, uint32_t> m_membershipTrace;
 
       protected:
         virtual void
@@ -230,12 +368,126 @@ namespace ns3
          *
          * @param exceptions Not IGMP interface.
          *
-         * Define the interface that are not IGMP-enabled.
-         * TODO: To implement.
+         * Define the interface that are not IGMP-enabled: they get no socket,
+         * hence send and receive no message, and keep no state, see PurgeInterface.
+         * The pairs a client registers on them wait for the exclusion to be lifted:
+         * the interfaces no longer excluded start over, see RestoreInterface.
          *
          */
         void SetInterfaceExclusions (std::set<uint32_t> exceptions);
 
+        /**
+         *
+         * \returns The interfaces not IGMP-enabled.
+         *
+         */
+        std::set<uint32_t>
+        GetInterfaceExclusions () const;
+
+        /**
+         *
+         * \param resolution Tick of the timer wheel.
+         *
+         * Set the resolution of the protocol timers, before any of them is scheduled.
+         *
+         */
+        void
+        SetTimerResolution (Time resolution);
+
+        /**
+         *
+         * \returns Tick of the timer wheel.
+         *
+         */
+        Time
+        GetTimerResolution () const;
+
+        /**
+         *
+         * \returns Number of packets sent in unicast.
+         *
+         */
+        uint32_t
+        GetUnicastTxPackets () const;
+
+        /**
+         *
+         * \returns Airtime saved sending in unicast, at UnicastRate, the packets otherwise broadcast at BroadcastRate.
+         *
+         */
+        Time
+        GetSavedAirtime () const;
+
+        /**
+         *
+         * \returns Number of router changes and searches avoided by the SNR smoothing, hysteresis and dwell time.
+         * An episode counts once, however many samples it lasts.
+         *
+         */
+        uint32_t
+        GetAvoidedSwitches () const;
+
+        /**
+         *
+         * \returns Number of reports and registers not sent because another client sent the same one.
+         *
+         */
+        uint32_t
+        GetSuppressedReports () const;
+
+        /**
+         *
+         * \param stream First stream index to use.
+         * \returns Number of stream indices used by this instance.
+         *
+         * Assign a fixed random variable stream number to the random variable of this instance,
+         * so that its draws do not depend on the other random variables created in the meanwhile.
+         *
+         */
+        int64_t
+        AssignStreams (int64_t stream);
+
+        /**
+         *
+         * \param source Multicast source.
+         * \param group Multicast group.
+         * \param interface Router interface.
+         * \returns Number of clients registered for the Source-Group pair on the interface, routers only.
+         *
+         * Only the clients heard within the client timeout are counted. With ReportSuppression or
+         * QueryMode some clients may stay silent, so the count is a lower bound.
+         *
+         */
+        uint32_t
+        GetClientCount (Ipv4Address source, Ipv4Address group, uint32_t interface);
+
+        /**
+         *
+         * \param source Multicast source.
+         * \param group Multicast group.
+         * \param interface Router interface.
+         * \returns The clients registered for the Source-Group pair on the interface, in address order.
+         *
+         */
+        std::vector<Ipv4Address>
+        GetClients (Ipv4Address source, Ipv4Address group, uint32_t interface);
+
+        /**
+         *
+         * \param role Node role, set before the memberships are registered.
+         *
+         */
+        void
+        SetPeerRole (PeerRole role);
+
+        /**
+         *
+         * \returns Node role.
+         *
+         */
+        PeerRole
+        GetPeerRole () const;
+
         /**
          *
          * \param str String to parse.
@@ -292,6 +544,40 @@ namespace ns3
         void
         UnregisterInterface (Ipv4Address source, Ipv4Address group, uint32_t interface);
 
+        /**
+         *
+         * \param source Multicast source.
+         * \param group Multicast group.
+         *
+         * Make a source of the group known to a router: the interfaces with any-source (*,G) clients
+         * are registered with PIM-DM for it. Sources are never forgotten.
+         *
+         */
+        void
+        AddGroupSource (Ipv4Address source, Ipv4Address group);
+
+        /**
+         *
+         * \param SG Source-Group tuple string.
+         *
+         * Make a source of the group known to a router, see AddGroupSource.
+         *
+         */
+        void
+        AddGroupSourceString (std::string SG);
+
+        /**
+         *
+         * \param packet Packet received, with its IPv4 header.
+         * \param ipv4 IPv4 stack of the node.
+         * \param interface Input interface.
+         *
+         * Rx trace sink of the IPv4 stack: a router learns the source of the multicast data, see AddGroupSource.
+         *
+         */
+        void
+        LearnSource (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+
       private:
         void
         Clear ();
@@ -332,6 +618,52 @@ namespace ns3
         // From Ipv4RoutingProtocol
         virtual void
         SetIpv4 (Ptr<Ipv4> ipv4);
+
+        /**
+         *
+         * \param interface Interface index.
+         *
+         * Open the socket of an interface on its first address, unless it is the loopback,
+         * and record it in the interface table.
+         *
+         */
+        void
+        OpenInterfaceSocket (uint32_t interface);
+
+        /**
+         *
+         * \param interface Interface index.
+         *
+         * Close the socket of an interface, if any, and clear its entry in the interface table.
+         *
+         */
+        void
+        CloseInterfaceSocket (uint32_t interface);
+
+        /**
+         *
+         * \param interface Interface index, just excluded.
+         *
+         * Close the socket of the interface and drop all its state: queued messages,
+         * report and refresh timers of the clients, clients and PIM-DM memberships of the routers.
+         * A client keeps the pairs registered on the interface for RestoreInterface.
+         *
+         */
+        void
+        PurgeInterface (uint32_t interface);
+
+        /**
+         *
+         * \param interface Interface index, no longer excluded.
+         *
+         * Open the socket of the interface if it is up, then start the discovery over:
+         * a client registers again the pairs kept by PurgeInterface, a router in query mode
+         * sends a general query.
+         *
+         */
+        void
+        RestoreInterface (uint32_t interface);
+
         // From Ipv4RoutingProtocol
         virtual void
         PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const;
@@ -372,12 +704,71 @@ namespace ns3
          *
          * \param socket
          *
-         * Parse a IGMP message, following the protocol rules.
+         * Read all the packets queued on the socket and parse their IGMP messages, following the protocol rules.
          *
          */
         void
         RecvIGMPX (Ptr<Socket> socket);
 
+        /**
+         *
+         * \param packet Packet received, without the IP header.
+         * \param sender Sender Address.
+         * \param receiver Receiver Address.
+         * \param interface Inbound interface.
+         *
+         * Parse the IGMP messages of a packet.
+         *
+         */
+        void
+        RecvIGMPXPacket (Ptr<Packet> packet, Ipv4Address sender, Ipv4Address receiver, uint32_t interface);
+
+        /**
+         *
+         * \param packet Packet starting with an IGMP message.
+         * \returns False if the message is an accept for a group the node never registered, which is removed
+         * from the packet unparsed; true otherwise.
+         *
+         */
+        bool
+        AcceptWanted (Ptr<Packet> packet);
+
+        /**
+         *
+         * \param state Client state of the Source-Group pair.
+         * \param router Router heard.
+         * \param snr SNR of the last message of the router.
+         * \returns The SNR of the router, smoothed with SnrSmoothing.
+         *
+         * The routers heard form the candidate table of the Source-Group pair:
+         * beyond RouterCandidates entries, the weakest router other than the associated one is forgotten.
+         *
+         */
+        double
+        SmoothSnr (IgmpState *state, Ipv4Address router, double snr);
+
+        /**
+         *
+         * \param state Client state of the Source-Group pair.
+         * \param router Router heard.
+         * \param avoided True if the last sample of the router called for a switch that was not made.
+         *
+         * Count the avoided switch when its episode starts; the episode ends with
+         * the first sample of the router that does not call for a switch, or with the switch.
+         *
+         */
+        void
+        CountAvoidedSwitch (IgmpState *state, Ipv4Address router, bool avoided);
+
+        /**
+         *
+         * \param state Client state of the Source-Group pair.
+         * \returns The candidate router with the best SNR heard within CandidateLifetime, ANY if none.
+         *
+         */
+        Ipv4Address
+        BestCandidate (IgmpState *state);
+
         /**
          *
          * \param packet Packet to send.
@@ -404,6 +795,72 @@ namespace ns3
         SendPacketIGMPXUnicast (Ptr<Packet> packet, const IGMPXHeader &message, int32_t interface,
                                 Ipv4Address destination);
 
+        /**
+         *
+         * \param packet Packet holding the IGMPX messages.
+         * \param interface Output interface.
+         * \param destination Target address.
+         *
+         * Add the IP header and send the packet on the specific interface.
+         *
+         */
+        void
+        SendPacketIGMPX (Ptr<Packet> packet, int32_t interface, Ipv4Address destination);
+
+        /**
+         *
+         * \param message Message to send in broadcast.
+         * \param interface Output interface.
+         *
+         * Queue the message on the interface: the queue is sent within TxQueueWindow,
+         * or right away when the message would make it exceed MaxPduSize.
+         *
+         */
+        void
+        EnqueueIGMPX (const IGMPXHeader &message, uint32_t interface);
+
+        /**
+         *
+         * \param message Message to send in broadcast.
+         * \param interface Output interface.
+         *
+         * Add the message to the queue of the interface without scheduling its transmission;
+         * the queue leaves right away when the message would make it exceed MaxPduSize.
+         *
+         */
+        void
+        AppendTxQueue (const IGMPXHeader &message, uint32_t interface);
+
+        /**
+         *
+         * \param interface Output interface.
+         *
+         * Schedule the transmission of the queue of the interface within TxQueueWindow, if not yet scheduled.
+         *
+         */
+        void
+        ArmTxQueue (uint32_t interface);
+
+        /**
+         *
+         * \param interface Output interface.
+         *
+         * Add the pending reports and accepts to the queue of the interface, then send it.
+         *
+         */
+        void
+        FlushTxQueue (uint32_t interface);
+
+        /**
+         *
+         * \param interface Output interface.
+         *
+         * Send the messages queued on the interface in a single packet.
+         *
+         */
+        void
+        SendTxQueue (uint32_t interface);
+
         /**
          *
          * \param sgp Target Source-Group pair.
@@ -450,6 +907,91 @@ namespace ns3
         void
         SendIgmpRegister (SourceGroupPair sgp, uint32_t interface);
 
+        /**
+         *
+         * \param router Associated router.
+         * \param interface Target interface.
+         *
+         * Schedule the refresh of the router on the interface, unless already scheduled.
+         *
+         */
+        void
+        StartRefresh (Ipv4Address router, uint32_t interface);
+
+        /**
+         *
+         * \param router Associated router.
+         * \param interface Target interface.
+         *
+         * Send one register listing all the Source-Group pairs associated to the router on the interface,
+         * but those another client refreshed meanwhile, and schedule the next refresh.
+         * The refresh stops when no pair is associated to the router any more.
+         *
+         */
+        void
+        RefreshRouter (Ipv4Address router, uint32_t interface);
+
+        /**
+         *
+         * \param record Report record (group, source, upstream).
+         * \param interface Target interface.
+         *
+         * Add a report to those pending on the interface, scheduling their transmission if needed:
+         * with the interface queue, or after a random delay if TxQueueWindow is zero.
+         * A register for the same Source-Group pair replaces the pending one,
+         * as does a discovery report (upstream set to ANY) a pending discovery report.
+         *
+         */
+        void
+        QueueIgmpReport (const IGMPXHeader::IgmpReportMessage &record, uint32_t interface);
+
+        /**
+         *
+         * \param sgp Source-Group pair.
+         * \param interface Interface index.
+         *
+         * Drop the reports of the pair still waiting to be sent on the interface.
+         *
+         */
+        void
+        DropPendingReports (SourceGroupPair sgp, uint32_t interface);
+
+        /**
+         *
+         * \param interface Target interface.
+         *
+         * Send all the reports pending on the interface in broadcast,
+         * packing them into multi-record reports, or add them to the interface queue.
+         *
+         */
+        void
+        FlushIgmpReports (uint32_t interface);
+
+        /**
+         *
+         * \param sgp Source-Group pair accepted.
+         * \param interface Outgoing interface.
+         * \param clientIP Client accepted.
+         *
+         * Add the client to the accept pending for the Source-Group pair on the interface,
+         * scheduling the transmission of the pending accepts if not yet scheduled:
+         * with the interface queue, or after a random delay if TxQueueWindow is zero.
+         *
+         */
+        void
+        QueueIgmpAccept (SourceGroupPair sgp, uint32_t interface, Ipv4Address clientIP);
+
+        /**
+         *
+         * \param interface Outgoing interface.
+         *
+         * Send the accepts pending on the interface, one per Source-Group pair,
+         * or add them to the interface queue.
+         *
+         */
+        void
+        FlushIgmpAccepts (uint32_t interface);
+
         /**
          *
          * \param sgp Target Source-Group pair.
@@ -462,6 +1004,63 @@ namespace ns3
         void
         RemoveClients (SourceGroupPair sgp, uint32_t interface);
 
+        /**
+         *
+         * \param sgp Target Source-Group pair.
+         * \param interface Target interface.
+         *
+         * Client timeout on a router: with lazy expiry the timer is rescheduled to the
+         * timeout of the last report, if that is still ahead; otherwise the clients are removed.
+         *
+         */
+        void
+        ClientsTimerExpire (SourceGroupPair sgp, uint32_t interface);
+
+        /**
+         *
+         * \param state Router state of the Source-Group pair.
+         * \param interface Target interface.
+         *
+         * Forget the clients of the interface not heard within the client timeout.
+         *
+         */
+        void
+        ExpireClients (IgmpState *state, uint32_t interface);
+
+        /**
+         *
+         * \param sgp Source-Group pair.
+         * \param interface Router interface.
+         * \param member True if the interface gained its first client, false if it lost the last one.
+         *
+         * Record a membership change for PIM-DM, to be delivered within MembershipBatch.
+         * A change undoing one still in the log cancels it: PIM-DM never hears of either.
+         *
+         */
+        void
+        NotifyMembership (SourceGroupPair sgp, uint32_t interface, bool member);
+
+        /**
+         *
+         * \param sgp Source-Group pair, the source may be ANY.
+         * \param interface Router interface.
+         * \param member True if the interface gained its first client, false if it lost the last one.
+         *
+         * Update the PIM-DM membership of the interface: for every source of the group known if the source is ANY.
+         * Only the first entry in and the last one out of an (S,G) membership are notified.
+         *
+         */
+        void
+        ChangeMembership (SourceGroupPair sgp, uint32_t interface, bool member);
+
+        /**
+         *
+         * Pass the logged membership changes to PIM-DM and clear the log.
+         *
+         */
+        void
+        FlushMembership ();
+
         /**
          *
          * \param report Igmp message.
@@ -477,6 +1076,82 @@ namespace ns3
         RecvIgmpReport (IGMPXHeader::IgmpReportMessage &report, Ipv4Address sender, Ipv4Address receiver,
                         uint32_t interface, double snr);
 
+        /**
+         *
+         * \param report Report of another client.
+         * \param interface Inbound interface.
+         *
+         * Drop the same report if pending on the interface, and restart its timer:
+         * the report timer for a discovery report; a register to the same router leaves the pair out of
+         * the next refresh of that router.
+         * In query mode only the answer to the query is cancelled.
+         *
+         */
+        void
+        SuppressIgmpReport (const IGMPXHeader::IgmpReportMessage &report, uint32_t interface);
+
+        /**
+         *
+         * \param sgp Source-Group pair left.
+         * \param interface Interface left.
+         * \param router Router of the client.
+         *
+         * Send an IGMP leave message for the router.
+         *
+         */
+        void
+        SendIgmpLeave (SourceGroupPair sgp, uint32_t interface, Ipv4Address router);
+
+        /**
+         *
+         * Send a general query on all the interfaces and schedule the next one after QueryInterval.
+         *
+         */
+        void
+        SendGeneralQuery ();
+
+        /**
+         *
+         * \param sgp Source-Group pair queried, both addresses set to ANY for a general query.
+         * \param interface Target interface.
+         * \param maxResponse Longest delay of the answers.
+         *
+         * Send an IGMP query in broadcast on the interface.
+         *
+         */
+        void
+        SendIgmpQuery (SourceGroupPair sgp, uint32_t interface, Time maxResponse);
+
+        /**
+         *
+         * \param query Igmp message.
+         * \param sender Sender Address.
+         * \param receiver Receiver Address.
+         * \param interface Inbound interface.
+         *
+         * Clients in query mode schedule the answer of the Source-Group pairs queried on the interface,
+         * at a random time within the maximum response time, unless an earlier answer is already due.
+         *
+         */
+        void
+        RecvIgmpQuery (IGMPXHeader::IgmpQueryMessage &query, Ipv4Address sender, Ipv4Address receiver,
+                       uint32_t interface);
+
+        /**
+         *
+         * \param leave Igmp message.
+         * \param sender Sender Address.
+         * \param receiver Receiver Address.
+         * \param interface Inbound interface.
+         *
+         * Routers addressed start the last member check of the Source-Group pair on the interface;
+         * clients of the same router for that pair register again to answer it.
+         *
+         */
+        void
+        RecvIgmpLeave (IGMPXHeader::IgmpLeaveMessage &leave, Ipv4Address sender, Ipv4Address receiver,
+                       uint32_t interface);
+
         /**
          *
          * \param sgp Target Source-Group pair.
@@ -489,6 +1164,18 @@ namespace ns3
         void
         SendIgmpAccept (SourceGroupPair sgp, uint32_t interface, Ipv4Address destination);
 
+        /**
+         *
+         * \param sgp Target Source-Group pair.
+         * \param interface Target interface.
+         * \param destination Associated client.
+         *
+         * Send an IGMP accept message in unicast to an associated client.
+         *
+         */
+        void
+        SendIgmpAcceptNode (SourceGroupPair sgp, uint32_t interface, Ipv4Address destination);
+
         /**
          *
          * \param accept Igmp Message.
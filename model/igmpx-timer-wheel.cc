@@ -0,0 +1,325 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+#include "igmpx-timer-wheel.h"
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+
+namespace ns3
+{
+  namespace igmpx
+  {
+    NS_LOG_COMPONENT_DEFINE ("IgmpxTimerWheel");
+
+    static const uint64_t NO_TICK = ~static_cast<uint64_t> (0);
+
+    TimerWheelEntry::TimerWheelEntry () :
+        m_running (0), m_expire (Seconds (0)), m_tick (0), m_bucket (0), m_prev (0), m_next (0)
+    {
+    }
+
+    TimerWheelEntry::~TimerWheelEntry ()
+    {
+      if (m_running != 0)
+        {
+          m_running->Remove (this);
+        }
+    }
+
+    bool
+    TimerWheelEntry::IsRunning () const
+    {
+      return m_running != 0;
+    }
+
+    Time
+    TimerWheelEntry::GetDelayLeft () const
+    {
+      if (m_running == 0 || m_expire < Simulator::Now ())
+        return Seconds (0);
+      return m_expire - Simulator::Now ();
+    }
+
+    TimerWheel::TimerWheel () :
+        m_resolution (MilliSeconds (10)), m_current (0), m_size (0), m_buckets (EXPIRED + 1, 0), m_eventTick (NO_TICK),
+        m_expiring (false)
+    {
+    }
+
+    TimerWheel::~TimerWheel ()
+    {
+      Clear ();
+    }
+
+    void
+    TimerWheel::SetResolution (Time resolution)
+    {
+      NS_ASSERT_MSG (m_size == 0, "Cannot change the resolution of a running wheel");
+      NS_ASSERT (resolution.GetTimeStep () > 0);
+      m_resolution = resolution;
+    }
+
+    Time
+    TimerWheel::GetResolution () const
+    {
+      return m_resolution;
+    }
+
+    uint32_t
+    TimerWheel::GetSize () const
+    {
+      return m_size;
+    }
+
+    inline uint32_t
+    TimerWheel::LevelBase (uint32_t level)
+    {
+      return (level == 0 ? 0 : (1 << ROOT_BITS) + (level - 1) * (1 << LEVEL_BITS));
+    }
+
+    inline uint32_t
+    TimerWheel::LevelShift (uint32_t level)
+    {
+      return (level == 0 ? 0 : ROOT_BITS + (level - 1) * LEVEL_BITS);
+    }
+
+    inline uint64_t
+    TimerWheel::TimeToTick (Time t) const
+    {
+      // Round up: an entry never expires before its time.
+      int64_t step = m_resolution.GetTimeStep ();
+      return (t.GetTimeStep () + step - 1) / step;
+    }
+
+    inline Time
+    TimerWheel::TickToTime (uint64_t tick) const
+    {
+      return TimeStep (tick * m_resolution.GetTimeStep ());
+    }
+
+    inline void
+    TimerWheel::Link (TimerWheelEntry *entry, uint32_t bucket)
+    {
+      entry->m_bucket = bucket;
+      entry->m_prev = 0;
+      entry->m_next = m_buckets[bucket];
+      if (entry->m_next != 0)
+        entry->m_next->m_prev = entry;
+      m_buckets[bucket] = entry;
+    }
+
+    inline void
+    TimerWheel::Unlink (TimerWheelEntry *entry)
+    {
+      if (entry->m_prev != 0)
+        entry->m_prev->m_next = entry->m_next;
+      else
+        m_buckets[entry->m_bucket] = entry->m_next;
+      if (entry->m_next != 0)
+        entry->m_next->m_prev = entry->m_prev;
+      entry->m_prev = 0;
+      entry->m_next = 0;
+    }
+
+    uint64_t
+    TimerWheel::Place (TimerWheelEntry *entry)
+    {
+      if (entry->m_tick < m_current)
+        entry->m_tick = m_current;
+      uint64_t tick = entry->m_tick;
+      if (m_expiring && tick == m_current)
+        {
+          // Scheduled by a callback for the tick being processed: it expires in the same round.
+          Link (entry, EXPIRED);
+          return NO_TICK;
+        }
+      uint64_t delta = tick - m_current;
+      if (delta < (1 << ROOT_BITS))
+        {
+          Link (entry, tick & ((1 << ROOT_BITS) - 1));
+          return tick;
+        }
+      uint32_t level = 1;
+      while (level < LEVELS - 1 && delta >= (static_cast<uint64_t> (1) << LevelShift (level + 1)))
+        {
+          level++;
+        }
+      if (level == LEVELS - 1 && delta >= (static_cast<uint64_t> (1) << (LevelShift (LEVELS - 1) + LEVEL_BITS)))
+        {
+          // Beyond the wheel span: park it in the farthest bucket, it moves down when that bucket does.
+          tick = m_current + (static_cast<uint64_t> (1) << (LevelShift (LEVELS - 1) + LEVEL_BITS)) - 1;
+        }
+      uint32_t shift = LevelShift (level);
+      Link (entry, LevelBase (level) + ((tick >> shift) & ((1 << LEVEL_BITS) - 1)));
+      return (tick >> shift) << shift;
+    }
+
+    void
+    TimerWheel::Insert (TimerWheelEntry *entry, Time delay)
+    {
+      NS_LOG_FUNCTION (this << entry << delay);
+      if (entry->m_running != 0)
+        {
+          NS_ASSERT (entry->m_running == this);
+          Unlink (entry);
+          m_size--;
+        }
+      // No tick before the current one has work left, catch up so that the entry lands in the lowest level possible.
+      uint64_t now = Simulator::Now ().GetTimeStep () / m_resolution.GetTimeStep ();
+      if (now > m_current)
+        {
+          m_current = now;
+        }
+      entry->m_expire = Simulator::Now () + delay;
+      entry->m_tick = TimeToTick (entry->m_expire);
+      entry->m_running = this;
+      m_size++;
+      Arm (Place (entry));
+    }
+
+    void
+    TimerWheel::Remove (TimerWheelEntry *entry)
+    {
+      NS_LOG_FUNCTION (this << entry);
+      NS_ASSERT (entry->m_running == this);
+      Unlink (entry);
+      entry->m_running = 0;
+      m_size--;
+      // The simulator event is left in place: if nothing is left to do, it just arms the next one.
+    }
+
+    void
+    TimerWheel::Clear ()
+    {
+      for (uint32_t b = 0; b < m_buckets.size (); b++)
+        {
+          while (m_buckets[b] != 0)
+            {
+              TimerWheelEntry *entry = m_buckets[b];
+              Unlink (entry);
+              entry->m_running = 0;
+            }
+        }
+      m_size = 0;
+      m_event.Cancel ();
+      m_eventTick = NO_TICK;
+    }
+
+    void
+    TimerWheel::Cascade (uint32_t level, uint32_t slot)
+    {
+      uint32_t bucket = LevelBase (level) + slot;
+      TimerWheelEntry *entry = m_buckets[bucket];
+      m_buckets[bucket] = 0;
+      while (entry != 0)
+        {
+          TimerWheelEntry *next = entry->m_next;
+          Place (entry);
+          entry = next;
+        }
+    }
+
+    uint64_t
+    TimerWheel::NextTick () const
+    {
+      uint64_t next = NO_TICK;
+      for (uint64_t tick = m_current; tick < m_current + (1 << ROOT_BITS); tick++)
+        {
+          if (m_buckets[tick & ((1 << ROOT_BITS) - 1)] != 0)
+            {
+              next = tick;
+              break;
+            }
+        }
+      for (uint32_t level = 1; level < LEVELS; level++)
+        {
+          uint32_t shift = LevelShift (level);
+          uint64_t boundary = ((m_current + (static_cast<uint64_t> (1) << shift) - 1) >> shift) << shift;
+          for (uint32_t i = 0; i < (1 << LEVEL_BITS) && boundary < next; i++, boundary += (static_cast<uint64_t> (1) << shift))
+            {
+              if (m_buckets[LevelBase (level) + ((boundary >> shift) & ((1 << LEVEL_BITS) - 1))] != 0)
+                {
+                  next = boundary;
+                  break;
+                }
+            }
+        }
+      return next;
+    }
+
+    void
+    TimerWheel::Arm (uint64_t tick)
+    {
+      if (tick == NO_TICK || (m_event.IsRunning () && m_eventTick <= tick))
+        return;
+      m_event.Cancel ();
+      m_eventTick = tick;
+      Time at = TickToTime (tick);
+      m_event = Simulator::Schedule ((at > Simulator::Now () ? at - Simulator::Now () : Seconds (0)), &TimerWheel::Advance, this);
+    }
+
+    void
+    TimerWheel::Advance ()
+    {
+      NS_LOG_FUNCTION (this << m_eventTick << m_size);
+      uint64_t tick = m_eventTick;
+      m_eventTick = NO_TICK;
+      NS_ASSERT (tick >= m_current);
+      m_current = tick;
+      // Move down the upper levels whose bucket starts at this tick, the farthest first.
+      for (uint32_t level = LEVELS - 1; level > 0; level--)
+        {
+          uint32_t shift = LevelShift (level);
+          if ((tick & ((static_cast<uint64_t> (1) << shift) - 1)) == 0)
+            {
+              Cascade (level, (tick >> shift) & ((1 << LEVEL_BITS) - 1));
+            }
+        }
+      // Detach the expired entries: the callbacks may schedule entries in this same bucket, one round later.
+      uint32_t slot = tick & ((1 << ROOT_BITS) - 1);
+      while (m_buckets[slot] != 0)
+        {
+          TimerWheelEntry *entry = m_buckets[slot];
+          NS_ASSERT (entry->m_tick == tick);
+          Unlink (entry);
+          Link (entry, EXPIRED);
+        }
+      m_expiring = true;
+      while (m_buckets[EXPIRED] != 0)
+        {
+          TimerWheelEntry *entry = m_buckets[EXPIRED];
+          Unlink (entry);
+          entry->m_running = 0;
+          m_size--;
+          entry->Expire ();
+        }
+      m_expiring = false;
+      m_current = tick + 1;
+      if (m_size > 0)
+        {
+          Arm (NextTick ());
+        }
+    }
+
+  } // namespace igmpx
+} // namespace ns3
@@ -0,0 +1,307 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+#ifndef __IGMPX_TIMER_WHEEL_H__
+#define __IGMPX_TIMER_WHEEL_H__
+
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/callback.h>
+#include <ns3/assert.h>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3
+{
+  namespace igmpx
+  {
+    class TimerWheel;
+
+    /**
+     * \brief An element that can be scheduled on a TimerWheel.
+     *
+     * The entry is linked in one bucket of the wheel while running;
+     * destroying a running entry removes it from the wheel.
+     */
+    class TimerWheelEntry
+    {
+      public:
+        TimerWheelEntry ();
+        virtual
+        ~TimerWheelEntry ();
+
+        /// \returns True if the entry is scheduled on a wheel.
+        bool
+        IsRunning () const;
+
+        /// \returns The time left before the expiration, zero if not running.
+        Time
+        GetDelayLeft () const;
+
+      protected:
+        /// Called by the wheel when the entry expires, after it has been removed.
+        virtual void
+        Expire () = 0;
+
+      private:
+        friend class TimerWheel;
+        /// Copy is not allowed, derived classes copy their configuration only.
+        TimerWheelEntry (const TimerWheelEntry &o);
+        TimerWheelEntry &
+        operator = (const TimerWheelEntry &o);
+
+        TimerWheel *m_running; ///< Wheel holding the entry, 0 if not running.
+        Time m_expire; ///< Absolute expiration time.
+        uint64_t m_tick; ///< Wheel tick of the expiration.
+        uint32_t m_bucket; ///< Bucket holding the entry.
+        TimerWheelEntry *m_prev;
+        TimerWheelEntry *m_next;
+    };
+
+    /**
+     * \brief Hierarchical timing wheel.
+     *
+     * Time is divided into ticks of a given resolution; expirations are rounded up to the next tick.
+     * The first level has 256 buckets of one tick, the three upper levels have 64 buckets each,
+     * covering 2^8, 2^14 and 2^20 ticks per bucket: with 10ms ticks the wheel spans about 7.7 days,
+     * later expirations are parked in the last level and moved down until they are in range.
+     * Insertion, rescheduling and removal are O(1) and do not touch the simulator:
+     * the wheel keeps at most one simulator event, set to the next tick having an expiration
+     * or a bucket to move down a level; ticks with no work are skipped.
+     */
+    class TimerWheel
+    {
+      public:
+        TimerWheel ();
+        ~TimerWheel ();
+
+        /**
+         * \param resolution Duration of a tick.
+         *
+         * Set the wheel resolution, which can change only when no entry is scheduled.
+         */
+        void
+        SetResolution (Time resolution);
+
+        Time
+        GetResolution () const;
+
+        /**
+         * \param entry Entry to schedule, removed first if it is running.
+         * \param delay Time from now to the expiration.
+         */
+        void
+        Insert (TimerWheelEntry *entry, Time delay);
+
+        /**
+         * \param entry Running entry to remove.
+         */
+        void
+        Remove (TimerWheelEntry *entry);
+
+        /// \returns The number of scheduled entries.
+        uint32_t
+        GetSize () const;
+
+        /// Remove all the entries without expiring them, and cancel the simulator event.
+        void
+        Clear ();
+
+      private:
+        TimerWheel (const TimerWheel &o);
+        TimerWheel &
+        operator = (const TimerWheel &o);
+
+        static const uint32_t LEVELS = 4;
+        static const uint32_t ROOT_BITS = 8; ///< Buckets of the first level are 2^ROOT_BITS.
+        static const uint32_t LEVEL_BITS = 6; ///< Buckets of the upper levels are 2^LEVEL_BITS.
+        static const uint32_t EXPIRED = 256 + 3 * 64; ///< Bucket of the entries expiring in the current tick.
+
+        /// \returns The first bucket of the given level.
+        static uint32_t
+        LevelBase (uint32_t level);
+        /// \returns The number of bits of the tick shifted out at the given level.
+        static uint32_t
+        LevelShift (uint32_t level);
+
+        uint64_t
+        TimeToTick (Time t) const;
+        Time
+        TickToTime (uint64_t tick) const;
+
+        void
+        Link (TimerWheelEntry *entry, uint32_t bucket);
+        void
+        Unlink (TimerWheelEntry *entry);
+
+        /**
+         * Link the entry in the bucket matching its tick, relative to the current tick.
+         * \returns The tick at which the wheel must handle the entry: its expiration or when its bucket moves down;
+         * NO_TICK if it expires in the tick being processed.
+         */
+        uint64_t
+        Place (TimerWheelEntry *entry);
+
+        /// Move down the entries of a bucket of an upper level.
+        void
+        Cascade (uint32_t level, uint32_t slot);
+
+        /// \returns The next tick with an expiration or a bucket to move down, or UINT64_MAX.
+        uint64_t
+        NextTick () const;
+
+        /// Make sure the simulator event fires no later than the given tick, if any.
+        void
+        Arm (uint64_t tick);
+
+        /// Simulator event: process the current tick and arm the next one.
+        void
+        Advance ();
+
+        Time m_resolution; ///< Duration of a tick.
+        uint64_t m_current; ///< Next tick to process.
+        uint32_t m_size; ///< Number of scheduled entries.
+        std::vector<TimerWheelEntry*> m_buckets; ///< Heads of the bucket lists, levels in sequence, EXPIRED last.
+        EventId m_event; ///< Pending simulator event.
+        uint64_t m_eventTick; ///< Tick of the pending simulator event.
+        bool m_expiring; ///< True while the callbacks of the current tick run.
+    };
+
+    /**
+     * \brief A Timer-like interface over a TimerWheel entry.
+     *
+     * It mirrors the subset of ns3::Timer used by the protocol: the function and its two arguments,
+     * the default delay, Schedule, Cancel, IsRunning and GetDelayLeft.
+     * Scheduling a running timer moves it, no Cancel is needed.
+     * Copies share the configuration, never the running state.
+     */
+    template <typename T1, typename T2>
+    class WheelTimer : public TimerWheelEntry
+    {
+      public:
+        WheelTimer (TimerWheel *wheel = 0) :
+            m_wheel (wheel), m_a1 (), m_a2 (), m_delay (Seconds (0))
+        {
+        }
+
+        WheelTimer (const WheelTimer &o) :
+            TimerWheelEntry (), m_wheel (o.m_wheel), m_function (o.m_function), m_a1 (o.m_a1), m_a2 (o.m_a2),
+            m_delay (o.m_delay)
+        {
+        }
+
+        WheelTimer &
+        operator = (const WheelTimer &o)
+        {
+          if (this != &o)
+            {
+              Cancel ();
+              m_wheel = o.m_wheel;
+              m_function = o.m_function;
+              m_a1 = o.m_a1;
+              m_a2 = o.m_a2;
+              m_delay = o.m_delay;
+            }
+          return *this;
+        }
+
+        void
+        SetWheel (TimerWheel *wheel)
+        {
+          NS_ASSERT (!IsRunning ());
+          m_wheel = wheel;
+        }
+
+        template <typename MEM_PTR, typename OBJ_PTR>
+        void
+        SetFunction (MEM_PTR memPtr, OBJ_PTR objPtr)
+        {
+          m_function = MakeCallback (memPtr, objPtr);
+        }
+
+        void
+        SetArguments (T1 a1, T2 a2)
+        {
+          m_a1 = a1;
+          m_a2 = a2;
+        }
+
+        void
+        SetDelay (const Time &delay)
+        {
+          m_delay = delay;
+        }
+
+        Time
+        GetDelay () const
+        {
+          return m_delay;
+        }
+
+        /// Schedule the timer after the default delay.
+        void
+        Schedule ()
+        {
+          Schedule (m_delay);
+        }
+
+        /// Schedule the timer after the given delay.
+        void
+        Schedule (Time delay)
+        {
+          NS_ASSERT (m_wheel != 0 && !m_function.IsNull ());
+          m_wheel->Insert (this, delay);
+        }
+
+        void
+        Cancel ()
+        {
+          if (IsRunning ())
+            {
+              m_wheel->Remove (this);
+            }
+        }
+
+      protected:
+        virtual void
+        Expire ()
+        {
+          // The callback may destroy this timer, work on copies.
+          Callback<void, T1, T2> function = m_function;
+          T1 a1 = m_a1;
+          T2 a2 = m_a2;
+          function (a1, a2);
+        }
+
+      private:
+        TimerWheel *m_wheel; ///< Wheel on which the timer is scheduled.
+        Callback<void, T1, T2> m_function;
+        T1 m_a1;
+        T2 m_a2;
+        Time m_delay; ///< Default delay.
+    };
+
+  } // namespace igmpx
+} // namespace ns3
+
+#endif
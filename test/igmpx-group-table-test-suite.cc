@@ -0,0 +1,313 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+#include <ns3/test.h>
+#include <ns3/igmpx-group-table.h>
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+  class IGMPXGroupTableTestCase : public TestCase
+  {
+    public:
+      IGMPXGroupTableTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXGroupTableTestCase::IGMPXGroupTableTestCase () :
+      TestCase("Check SourceGroupTable against std::map")
+  {
+  }
+  void
+  IGMPXGroupTableTestCase::DoRun (void)
+  {
+    igmpx::SourceGroupTable<uint32_t> table;
+    std::map<uint64_t, uint32_t> reference;
+    uint32_t seed = 1;
+    // Few sources and groups, so that inserts, erases and lookups hit the same keys and the probe chains collide.
+    for (uint32_t step = 0; step < 100000; step++)
+      {
+        seed = seed * 1664525 + 1013904223;
+        Ipv4Address source (0x0a000000 | ((seed >> 8) % 16));
+        Ipv4Address group (0xe1000000 | ((seed >> 16) % 64));
+        uint64_t key = igmpx::PackSourceGroup (source, group);
+        switch (seed >> 30)
+          {
+          case 0:
+          case 1:
+            {
+              uint32_t *value = table.Insert (key, step);
+              if (reference.find (key) == reference.end ())
+                reference[key] = step;
+              NS_TEST_ASSERT_MSG_EQ (*value, reference[key], "Insert value");
+              break;
+            }
+          case 2:
+            {
+              bool erased = table.Erase (key);
+              NS_TEST_ASSERT_MSG_EQ (erased, reference.erase (key) == 1, "Erase");
+              break;
+            }
+          default:
+            {
+              uint32_t *value = table.Find (key);
+              NS_TEST_ASSERT_MSG_EQ ((value != 0), (reference.find (key) != reference.end ()), "Find");
+              if (value != 0)
+                NS_TEST_ASSERT_MSG_EQ (*value, reference[key], "Find value");
+              break;
+            }
+          }
+        NS_TEST_ASSERT_MSG_EQ (table.Size (), reference.size (), "Size");
+      }
+    for (uint32_t i = 0; i < table.Size (); i++)
+      {
+        NS_TEST_ASSERT_MSG_EQ (*table.Get (i), reference[table.GetKey (i)], "Dense array");
+      }
+    table.Clear ();
+    NS_TEST_ASSERT_MSG_EQ (table.Empty (), true, "Clear");
+  }
+
+  class IGMPXGroupFilterTestCase : public TestCase
+  {
+    public:
+      IGMPXGroupFilterTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXGroupFilterTestCase::IGMPXGroupFilterTestCase () :
+      TestCase("Check GroupFilter")
+  {
+  }
+  void
+  IGMPXGroupFilterTestCase::DoRun (void)
+  {
+    igmpx::GroupFilter filter;
+    NS_TEST_ASSERT_MSG_EQ (filter.MayContain (Ipv4Address ("225.1.2.3")), false, "Empty filter");
+    for (uint32_t i = 0; i < 50; i++)
+      {
+        filter.Insert (Ipv4Address (0xe1000000 | (i * 7)));
+      }
+    for (uint32_t i = 0; i < 50; i++)
+      {
+        NS_TEST_ASSERT_MSG_EQ (filter.MayContain (Ipv4Address (0xe1000000 | (i * 7))), true, "Inserted group");
+      }
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < 10000; i++)
+      {
+        hits += filter.MayContain (Ipv4Address (0xe2000000 | i));
+      }
+    // Two bits per group out of 1024: about 1% of false positives with 50 groups.
+    NS_TEST_ASSERT_MSG_LT (hits, 500u, "False positives");
+    filter.Clear ();
+    NS_TEST_ASSERT_MSG_EQ (filter.MayContain (Ipv4Address (0xe1000000)), false, "Clear");
+  }
+
+  class IGMPXClientSetTestCase : public TestCase
+  {
+    public:
+      IGMPXClientSetTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXClientSetTestCase::IGMPXClientSetTestCase () :
+      TestCase("Check ClientSet against std::map")
+  {
+  }
+  void
+  IGMPXClientSetTestCase::DoRun (void)
+  {
+    igmpx::ClientSet clients;
+    std::map<Ipv4Address, Time> reference;
+    uint32_t seed = 7;
+    for (uint32_t step = 1; step <= 10000; step++)
+      {
+        seed = seed * 1664525 + 1013904223;
+        Ipv4Address client (0x0a000100 | ((seed >> 8) % 32));
+        Time now = Seconds (step);
+        switch (seed >> 30)
+          {
+          case 0:
+          case 1:
+            NS_TEST_ASSERT_MSG_EQ (clients.Refresh (client, now), reference.find (client) == reference.end (), "Refresh");
+            reference[client] = now;
+            break;
+          case 2:
+            NS_TEST_ASSERT_MSG_EQ (clients.Remove (client), reference.erase (client) == 1, "Remove");
+            break;
+          default:
+            {
+              Time deadline = now - Seconds (20);
+              uint32_t expired = 0;
+              for (std::map<Ipv4Address, Time>::iterator iter = reference.begin (); iter != reference.end ();)
+                {
+                  if (iter->second < deadline)
+                    {
+                      reference.erase (iter++);
+                      expired++;
+                    }
+                  else
+                    iter++;
+                }
+              NS_TEST_ASSERT_MSG_EQ (clients.Expire (deadline), expired, "Expire");
+              break;
+            }
+          }
+        NS_TEST_ASSERT_MSG_EQ (clients.Size (), reference.size (), "Size");
+        NS_TEST_ASSERT_MSG_EQ (clients.Contains (client), reference.find (client) != reference.end (), "Contains");
+      }
+    uint32_t i = 0;
+    for (std::map<Ipv4Address, Time>::iterator iter = reference.begin (); iter != reference.end (); iter++, i++)
+      {
+        NS_TEST_ASSERT_MSG_EQ (clients.GetClient (i), iter->first, "Address order");
+        NS_TEST_ASSERT_MSG_EQ (clients.GetLastSeen (i), iter->second, "Last seen");
+      }
+    clients.Clear ();
+    NS_TEST_ASSERT_MSG_EQ (clients.Empty (), true, "Clear");
+  }
+
+  class IGMPXPimMembershipTestCase : public TestCase
+  {
+    public:
+      IGMPXPimMembershipTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXPimMembershipTestCase::IGMPXPimMembershipTestCase () :
+      TestCase("Check PimMembership with (S,G) and any-source (*,G) entries")
+  {
+  }
+  void
+  IGMPXPimMembershipTestCase::DoRun (void)
+  {
+    igmpx::PimMembership members;
+    std::vector<igmpx::PimMembership::Change> changes;
+    Ipv4Address any = Ipv4Address::GetAny ();
+    Ipv4Address group ("225.1.2.3");
+    Ipv4Address s1 ("10.0.0.1");
+    Ipv4Address s2 ("10.0.0.2");
+    // (*,G) joins before any source is known: nothing for PIM-DM yet.
+    members.Join (any, group, 1, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 0u, "Join before the sources");
+    // The sources learned later reach the (*,G) interface.
+    NS_TEST_ASSERT_MSG_EQ (members.AddSource (s1, group, changes), true, "New source");
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 1u, "Fan-out to the new source");
+    NS_TEST_ASSERT_MSG_EQ (changes[0].source, s1, "Source of the join");
+    NS_TEST_ASSERT_MSG_EQ (changes[0].interface, 1u, "Interface of the join");
+    NS_TEST_ASSERT_MSG_EQ (changes[0].member, true, "Join");
+    NS_TEST_ASSERT_MSG_EQ (members.IsMember (s1, group, 1), true, "Member after the source");
+    changes.clear ();
+    NS_TEST_ASSERT_MSG_EQ (members.AddSource (s1, group, changes), false, "Known source");
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 0u, "No fan-out for a known source");
+    members.AddSource (s2, group, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 1u, "Fan-out to the second source");
+    changes.clear ();
+    // An (S,G) entry on the same interface shares the membership.
+    members.Join (s1, group, 1, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 0u, "(S,G) over (*,G)");
+    members.Leave (any, group, 1, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 1u, "(*,G) leaves, (S,G) stays");
+    NS_TEST_ASSERT_MSG_EQ (changes[0].source, s2, "Only the second source leaves");
+    NS_TEST_ASSERT_MSG_EQ (changes[0].member, false, "Leave");
+    NS_TEST_ASSERT_MSG_EQ (members.IsMember (s1, group, 1), true, "(S,G) kept");
+    changes.clear ();
+    members.Leave (s1, group, 1, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 1u, "Last entry out");
+    NS_TEST_ASSERT_MSG_EQ (members.IsMember (s1, group, 1), false, "No member left");
+    changes.clear ();
+    // A (*,G) joining after the sources are known gets all of them at once.
+    members.Join (any, group, 2, changes);
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 2u, "Join after the sources");
+    members.Clear ();
+    NS_TEST_ASSERT_MSG_EQ (members.IsSourceKnown (s1, group), false, "Clear");
+  }
+
+  class IGMPXAddressTableTestCase : public TestCase
+  {
+    public:
+      IGMPXAddressTableTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXAddressTableTestCase::IGMPXAddressTableTestCase () :
+      TestCase("Check AddressTable")
+  {
+  }
+  void
+  IGMPXAddressTableTestCase::DoRun (void)
+  {
+    igmpx::AddressTable table;
+    uint32_t interface = 0;
+    NS_TEST_ASSERT_MSG_EQ (table.Contains (Ipv4Address ("10.1.1.1")), false, "Empty table");
+    table.Insert (Ipv4Address ("10.1.1.1"), 1);
+    table.Insert (Ipv4Address ("10.1.2.1"), 2);
+    NS_TEST_ASSERT_MSG_EQ (table.Find (Ipv4Address ("10.1.2.1"), interface), true, "Inserted address");
+    NS_TEST_ASSERT_MSG_EQ (interface, 2u, "Interface of the address");
+    table.Insert (Ipv4Address ("10.1.2.1"), 3);
+    table.Find (Ipv4Address ("10.1.2.1"), interface);
+    NS_TEST_ASSERT_MSG_EQ (interface, 3u, "Interface replaced");
+    NS_TEST_ASSERT_MSG_EQ (table.Size (), 2u, "No duplicate");
+    // Past the initial slots, and with erasures leaving the probe chains intact.
+    for (uint32_t i = 0; i < 100; i++)
+      {
+        table.Insert (Ipv4Address (0x0a020000 | i), i + 10);
+      }
+    for (uint32_t i = 0; i < 100; i += 2)
+      {
+        NS_TEST_ASSERT_MSG_EQ (table.Erase (Ipv4Address (0x0a020000 | i)), true, "Erase");
+      }
+    NS_TEST_ASSERT_MSG_EQ (table.Erase (Ipv4Address (0x0a020000)), false, "Erased twice");
+    for (uint32_t i = 1; i < 100; i += 2)
+      {
+        NS_TEST_ASSERT_MSG_EQ (table.Find (Ipv4Address (0x0a020000 | i), interface), true, "Kept address");
+        NS_TEST_ASSERT_MSG_EQ (interface, i + 10, "Kept interface");
+      }
+    NS_TEST_ASSERT_MSG_EQ (table.Size (), 52u, "Size");
+    table.Clear ();
+    NS_TEST_ASSERT_MSG_EQ (table.Contains (Ipv4Address ("10.1.1.1")), false, "Clear");
+  }
+
+  static class IgmpxGroupTableTestSuite : public TestSuite
+  {
+    public:
+      IgmpxGroupTableTestSuite ();
+  } j_igmpxGroupTableTestSuite;
+
+  IgmpxGroupTableTestSuite::IgmpxGroupTableTestSuite () :
+      TestSuite("igmpx-group-table", UNIT)
+  {
+    // RUN $ ./test.py -s igmpx-group-table -v -c unit 1
+    AddTestCase(new IGMPXGroupTableTestCase());
+    AddTestCase(new IGMPXGroupFilterTestCase());
+    AddTestCase(new IGMPXClientSetTestCase());
+    AddTestCase(new IGMPXPimMembershipTestCase());
+    AddTestCase(new IGMPXAddressTableTestCase());
+  }
+
+} // namespace ns3
@@ -113,6 +113,204 @@ namespace ns3
       }
   }
 
+  class IGMPXMultiReportTestCase : public TestCase
+  {
+    public:
+      IGMPXMultiReportTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXMultiReportTestCase::IGMPXMultiReportTestCase () :
+      TestCase("Check IGMPXMultiReport messages")
+  {
+  }
+  void
+  IGMPXMultiReportTestCase::DoRun (void)
+  {
+    Packet packet;
+      {
+        std::cout << "Testing MultiReport In Start..." << "\n";
+        igmpx::IGMPXHeader msgIn(igmpx::IGMPX_REPORT_MULTI);
+        igmpx::IGMPXHeader::IgmpMultiReportMessage &multiReport = msgIn.GetIgmpMultiReportMessage();
+        for (uint32_t i = 0; i < 3; i++)
+          {
+            igmpx::IGMPXHeader::IgmpReportMessage record;
+            record.m_multicastGroupAddr = Ipv4Address(0xe1000000 | (i + 1));
+            record.m_sourceAddr = Ipv4Address("10.1.1.2");
+            record.m_upstreamAddr = (i == 0 ? Ipv4Address::GetAny() : Ipv4Address("10.10.1.1"));
+            multiReport.m_records.push_back(record);
+          }
+        packet.AddHeader(msgIn);
+        NS_TEST_ASSERT_MSG_EQ(packet.GetSize(), 4 + 4 + 3 * igmpx::IGMPX_RECORD_SIZE, "MultiReport size");
+        msgIn.Print(std::cout);
+        multiReport.Print(std::cout);
+        std::cout << "Testing MultiReport In End." << "\n";
+      }
+      {
+        std::cout << "Testing MultiReport Out Start..." << "\n";
+        igmpx::IGMPXHeader msgOut;
+        packet.RemoveHeader(msgOut);
+        igmpx::IGMPXHeader::IgmpMultiReportMessage &multiReport = msgOut.GetIgmpMultiReportMessage();
+        msgOut.Print(std::cout);
+        multiReport.Print(std::cout);
+        NS_TEST_ASSERT_MSG_EQ(msgOut.GetType(), igmpx::IGMPX_REPORT_MULTI, "IGMP Type");
+        NS_TEST_ASSERT_MSG_EQ(multiReport.m_records.size(), 3u, "Records");
+        for (uint32_t i = 0; i < 3; i++)
+          {
+            NS_TEST_ASSERT_MSG_EQ(multiReport.m_records[i].m_multicastGroupAddr, Ipv4Address (0xe1000000 | (i + 1)), "Multicast Addr");
+            NS_TEST_ASSERT_MSG_EQ(multiReport.m_records[i].m_sourceAddr, Ipv4Address ("10.1.1.2"), "Source Addr");
+          }
+        NS_TEST_ASSERT_MSG_EQ(multiReport.m_records[0].m_upstreamAddr, Ipv4Address::GetAny (), "Upstream Addr");
+        NS_TEST_ASSERT_MSG_EQ(multiReport.m_records[2].m_upstreamAddr, Ipv4Address ("10.10.1.1"), "Upstream Addr");
+        std::cout << "Testing MultiReport Out End" << "\n";
+      }
+  }
+
+  class IGMPXMultiAcceptTestCase : public TestCase
+  {
+    public:
+      IGMPXMultiAcceptTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXMultiAcceptTestCase::IGMPXMultiAcceptTestCase () :
+      TestCase("Check IGMPXMultiAccept messages")
+  {
+  }
+  void
+  IGMPXMultiAcceptTestCase::DoRun (void)
+  {
+    Packet packet;
+      {
+        std::cout << "Testing MultiAccept In Start..." << "\n";
+        igmpx::IGMPXHeader msgIn(igmpx::IGMPX_ACCEPT_MULTI);
+        igmpx::IGMPXHeader::IgmpMultiAcceptMessage &multiAccept = msgIn.GetIgmpMultiAcceptMessage();
+        multiAccept.m_multicastGroupAddr = Ipv4Address("226.1.2.3");
+        multiAccept.m_sourceAddr = Ipv4Address("10.1.1.3");
+        for (uint32_t i = 0; i < 4; i++)
+          {
+            multiAccept.m_downstreamAddrs.push_back(Ipv4Address(0x0a0a0200 | (i + 1)));
+          }
+        packet.AddHeader(msgIn);
+        NS_TEST_ASSERT_MSG_EQ(packet.GetSize(), 4 + 4 + 2 * igmpx::IPV4_ADDRESS_SIZE + 4 * igmpx::IPV4_ADDRESS_SIZE, "MultiAccept size");
+        msgIn.Print(std::cout);
+        multiAccept.Print(std::cout);
+        std::cout << "Testing MultiAccept In End." << "\n";
+      }
+      {
+        std::cout << "Testing MultiAccept Out Start..." << "\n";
+        igmpx::IGMPXHeader msgOut;
+        packet.RemoveHeader(msgOut);
+        igmpx::IGMPXHeader::IgmpMultiAcceptMessage &multiAccept = msgOut.GetIgmpMultiAcceptMessage();
+        msgOut.Print(std::cout);
+        multiAccept.Print(std::cout);
+        NS_TEST_ASSERT_MSG_EQ(msgOut.GetType(), igmpx::IGMPX_ACCEPT_MULTI, "IGMP Type");
+        NS_TEST_ASSERT_MSG_EQ(multiAccept.m_multicastGroupAddr, Ipv4Address ("226.1.2.3"), "Multicast Addr");
+        NS_TEST_ASSERT_MSG_EQ(multiAccept.m_sourceAddr, Ipv4Address ("10.1.1.3"), "Source Addr");
+        NS_TEST_ASSERT_MSG_EQ(multiAccept.m_downstreamAddrs.size(), 4u, "Downstreams");
+        for (uint32_t i = 0; i < 4; i++)
+          {
+            NS_TEST_ASSERT_MSG_EQ(multiAccept.m_downstreamAddrs[i], Ipv4Address (0x0a0a0200 | (i + 1)), "Downstream Addr");
+          }
+        std::cout << "Testing MultiAccept Out End" << "\n";
+      }
+  }
+
+  class IGMPXCoalescedTestCase : public TestCase
+  {
+    public:
+      IGMPXCoalescedTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXCoalescedTestCase::IGMPXCoalescedTestCase () :
+      TestCase("Check IGMPX messages sharing a packet")
+  {
+  }
+  void
+  IGMPXCoalescedTestCase::DoRun (void)
+  {
+    Packet packet;
+      {
+        std::cout << "Testing Coalesced In Start..." << "\n";
+        // Headers are prepended: the accept is added last to be read first.
+        igmpx::IGMPXHeader reportIn(igmpx::IGMPX_REPORT);
+        igmpx::IGMPXHeader::IgmpReportMessage &report = reportIn.GetIgmpReportMessage();
+        report.m_multicastGroupAddr = Ipv4Address("225.1.2.3");
+        report.m_sourceAddr = Ipv4Address("10.1.1.2");
+        report.m_upstreamAddr = Ipv4Address("10.10.1.1");
+        packet.AddHeader(reportIn);
+        igmpx::IGMPXHeader acceptIn(igmpx::IGMPX_ACCEPT);
+        igmpx::IGMPXHeader::IgmpAcceptMessage &accept = acceptIn.GetIgmpAcceptMessage();
+        accept.m_multicastGroupAddr = Ipv4Address("226.1.2.3");
+        accept.m_sourceAddr = Ipv4Address("10.1.1.3");
+        accept.m_downstreamAddr = Ipv4Address("10.10.2.1");
+        packet.AddHeader(acceptIn);
+        NS_TEST_ASSERT_MSG_EQ(packet.GetSize(), reportIn.GetSerializedSize() + acceptIn.GetSerializedSize(), "Packet size");
+        std::cout << "Testing Coalesced In End." << "\n";
+      }
+      {
+        std::cout << "Testing Coalesced Out Start..." << "\n";
+        igmpx::IGMPXHeader acceptOut;
+        packet.RemoveHeader(acceptOut);
+        NS_TEST_ASSERT_MSG_EQ(acceptOut.GetType(), igmpx::IGMPX_ACCEPT, "IGMP Type");
+        NS_TEST_ASSERT_MSG_EQ(acceptOut.GetIgmpAcceptMessage().m_downstreamAddr, Ipv4Address ("10.10.2.1"), "Downstream Addr");
+        NS_TEST_ASSERT_MSG_NE(packet.GetSize(), 0u, "Second message");
+        igmpx::IGMPXHeader reportOut;
+        packet.RemoveHeader(reportOut);
+        NS_TEST_ASSERT_MSG_EQ(reportOut.GetType(), igmpx::IGMPX_REPORT, "IGMP Type");
+        NS_TEST_ASSERT_MSG_EQ(reportOut.GetIgmpReportMessage().m_multicastGroupAddr, Ipv4Address ("225.1.2.3"), "Multicast Addr");
+        NS_TEST_ASSERT_MSG_EQ(reportOut.GetIgmpReportMessage().m_upstreamAddr, Ipv4Address ("10.10.1.1"), "Upstream Addr");
+        NS_TEST_ASSERT_MSG_EQ(packet.GetSize(), 0u, "Packet consumed");
+        std::cout << "Testing Coalesced Out End" << "\n";
+      }
+  }
+
+  class IGMPXQueryTestCase : public TestCase
+  {
+    public:
+      IGMPXQueryTestCase ();
+      virtual void
+      DoRun (void);
+  };
+
+  IGMPXQueryTestCase::IGMPXQueryTestCase () :
+      TestCase("Check IGMPXQuery messages")
+  {
+  }
+  void
+  IGMPXQueryTestCase::DoRun (void)
+  {
+    Packet packet;
+      {
+        std::cout << "Testing Query In Start..." << "\n";
+        igmpx::IGMPXHeader msgIn(igmpx::IGMPX_QUERY);
+        igmpx::IGMPXHeader::IgmpQueryMessage &query = msgIn.GetIgmpQueryMessage();
+        query.m_multicastGroupAddr = Ipv4Address("226.1.2.3");
+        query.m_sourceAddr = Ipv4Address::GetAny();
+        query.m_maxResponseTime = 1500;
+        packet.AddHeader(msgIn);
+        msgIn.Print(std::cout);
+        std::cout << "Testing Query In End." << "\n";
+      }
+      {
+        std::cout << "Testing Query Out Start..." << "\n";
+        igmpx::IGMPXHeader msgOut;
+        packet.RemoveHeader(msgOut);
+        msgOut.Print(std::cout);
+        igmpx::IGMPXHeader::IgmpQueryMessage &query = msgOut.GetIgmpQueryMessage();
+        query.Print(std::cout);
+        NS_TEST_ASSERT_MSG_EQ(msgOut.GetType(), igmpx::IGMPX_QUERY, "IGMP Type");
+        NS_TEST_ASSERT_MSG_EQ(query.m_multicastGroupAddr, Ipv4Address ("226.1.2.3"), "Multicast Addr");
+        NS_TEST_ASSERT_MSG_EQ(query.m_sourceAddr, Ipv4Address::GetAny (), "Source Addr");
+        NS_TEST_ASSERT_MSG_EQ(query.m_maxResponseTime, 1500u, "Max Response Time");
+        std::cout << "Testing Query Out End" << "\n";
+      }
+  }
+
   static class IgmpxTestSuite : public TestSuite
   {
     public:
@@ -125,6 +323,10 @@ namespace ns3
     // RUN $ ./test.py -s igmpx-header -v -c unit 1
     AddTestCase(new IGMPXReportTestCase());
     AddTestCase(new IGMPXAcceptTestCase());
+    AddTestCase(new IGMPXMultiReportTestCase());
+    AddTestCase(new IGMPXMultiAcceptTestCase());
+    AddTestCase(new IGMPXCoalescedTestCase());
+    AddTestCase(new IGMPXQueryTestCase());
   }
 
 } // namespace ns3
@@ -0,0 +1,443 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <ns3/boolean.h>
+#include <ns3/string.h>
+#include <ns3/vector.h>
+#include <ns3/node-container.h>
+#include <ns3/net-device-container.h>
+#include <ns3/simple-net-device.h>
+#include <ns3/simple-channel.h>
+#include <ns3/mac48-address.h>
+#include <ns3/socket.h>
+#include <ns3/inet-socket-address.h>
+#include <ns3/ipv4-header.h>
+#include <ns3/ipv4-raw-socket-factory.h>
+#include <ns3/internet-stack-helper.h>
+#include <ns3/ipv4-address-helper.h>
+#include <ns3/ipv4-list-routing-helper.h>
+#include <ns3/ipv4-static-routing-helper.h>
+#include <ns3/wifi-helper.h>
+#include <ns3/yans-wifi-helper.h>
+#include <ns3/nqos-wifi-mac-helper.h>
+#include <ns3/mobility-helper.h>
+#include <ns3/position-allocator.h>
+#include <ns3/igmpx-helper.h>
+#include <ns3/igmpx-packet.h>
+#include <ns3/igmpx-routing.h>
+#include <set>
+
+namespace ns3
+{
+
+  /**
+   * \param nodes Nodes to install.
+   *
+   * Install the internet stack, with IGMPX next to the static routing.
+   */
+  static void
+  InstallIgmpx (NodeContainer nodes)
+  {
+    IgmpxHelper igmpx;
+    Ipv4StaticRoutingHelper staticRouting;
+    Ipv4ListRoutingHelper list;
+    list.Add (staticRouting, 0);
+    list.Add (igmpx, 1);
+    InternetStackHelper internet;
+    internet.SetRoutingHelper (list);
+    internet.Install (nodes);
+  }
+
+  /**
+   * \param nodes Nodes of the LAN.
+   * \param channels Number of channels: every node gets one device on each.
+   * \returns The devices, channel by channel.
+   *
+   * Build a LAN of simple devices running IGMPX. The simple devices carry no SNR:
+   * the clients cannot associate to a router on them.
+   */
+  static NetDeviceContainer
+  BuildIgmpxLan (NodeContainer nodes, uint32_t channels)
+  {
+    NetDeviceContainer devices;
+    for (uint32_t c = 0; c < channels; c++)
+      {
+        Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+        for (uint32_t n = 0; n < nodes.GetN (); n++)
+          {
+            Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+            device->SetAddress (Mac48Address::Allocate ());
+            device->SetChannel (channel);
+            nodes.Get (n)->AddDevice (device);
+            devices.Add (device);
+          }
+      }
+    InstallIgmpx (nodes);
+    Ipv4AddressHelper ipv4;
+    for (uint32_t c = 0; c < channels; c++)
+      {
+        NetDeviceContainer lan;
+        for (uint32_t n = 0; n < nodes.GetN (); n++)
+          {
+            lan.Add (devices.Get (c * nodes.GetN () + n));
+          }
+        ipv4.SetBase (Ipv4Address (0x0a010100 + (c << 8)), Ipv4Mask ("255.255.255.0"));
+        ipv4.Assign (lan);
+      }
+    return devices;
+  }
+
+  /**
+   * \param nodes Nodes of the cell, one meter apart.
+   *
+   * Build an ad hoc WiFi cell running IGMPX, on 10.1.1.0/24.
+   */
+  static void
+  BuildIgmpxWifi (NodeContainer nodes)
+  {
+    WifiHelper wifi = WifiHelper::Default ();
+    wifi.SetStandard (WIFI_PHY_STANDARD_80211g);
+    wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("ErpOfdmRate54Mbps"),
+        "ControlMode", StringValue ("ErpOfdmRate54Mbps"), "NonUnicastMode", StringValue ("ErpOfdmRate54Mbps"));
+    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
+    YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+    phy.SetChannel (wifiChannel.Create ());
+    NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+    mac.SetType ("ns3::AdhocWifiMac");
+    NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+    for (uint32_t n = 0; n < nodes.GetN (); n++)
+      {
+        positions->Add (Vector (n, 0, 0));
+      }
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator (positions);
+    mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    mobility.Install (nodes);
+    InstallIgmpx (nodes);
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+    ipv4.Assign (devices);
+  }
+
+  class IGMPXRouterExclusionTestCase : public TestCase
+  {
+    public:
+      IGMPXRouterExclusionTestCase ();
+      virtual void
+      DoRun (void);
+
+    private:
+      void
+      SendReport ();
+      void
+      Exclude (bool excluded, uint32_t clients);
+      void
+      Check (uint32_t clients);
+
+      Ptr<igmpx::IGMPXRoutingProtocol> m_router;
+      Ptr<Socket> m_client;
+      Ipv4Address m_routerAddress;
+  };
+
+  IGMPXRouterExclusionTestCase::IGMPXRouterExclusionTestCase () :
+      TestCase("Check that a router drops the clients of an excluded interface and hears them again once restored")
+  {
+  }
+
+  void
+  IGMPXRouterExclusionTestCase::SendReport ()
+  {
+    // The register of a client associated to the router.
+    igmpx::IGMPXHeader report (igmpx::IGMPX_REPORT);
+    igmpx::IGMPXHeader::IgmpReportMessage &record = report.GetIgmpReportMessage ();
+    record.m_sourceAddr = Ipv4Address ("10.0.1.1");
+    record.m_multicastGroupAddr = Ipv4Address ("225.1.2.4");
+    record.m_upstreamAddr = m_routerAddress;
+    Ptr<Packet> packet = Create<Packet> ();
+    packet->AddHeader (report);
+    m_client->SendTo (packet, 0, InetSocketAddress (m_routerAddress, 0));
+  }
+
+  void
+  IGMPXRouterExclusionTestCase::Exclude (bool excluded, uint32_t clients)
+  {
+    Check (clients);
+    std::set<uint32_t> exclusions;
+    if (excluded)
+      exclusions.insert (1);
+    m_router->SetInterfaceExclusions (exclusions);
+    // The state of the interface goes with the exclusion, not with the client timeout.
+    if (excluded)
+      Check (0);
+  }
+
+  void
+  IGMPXRouterExclusionTestCase::Check (uint32_t clients)
+  {
+    NS_TEST_ASSERT_MSG_EQ (m_router->GetClientCount (Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 1), clients,
+        "Clients at " << Simulator::Now ().GetSeconds ());
+  }
+
+  void
+  IGMPXRouterExclusionTestCase::DoRun (void)
+  {
+    NodeContainer nodes;
+    nodes.Create (2);
+    BuildIgmpxLan (nodes, 1);
+    m_router = nodes.Get (0)->GetObject<igmpx::IGMPXRoutingProtocol> ();
+    m_router->SetPeerRole (igmpx::ROUTER);
+    m_routerAddress = nodes.Get (0)->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
+    // The client is a plain raw socket: it registers with the router through hand-made reports.
+    m_client = Socket::CreateSocket (nodes.Get (1), Ipv4RawSocketFactory::GetTypeId ());
+    m_client->SetAttribute ("Protocol", UintegerValue (igmpx::IGMPX_IP_PROTOCOL_NUM));
+    for (uint32_t i = 0; i < 3; i++)
+      {
+        Simulator::Schedule (Seconds (1 + 2 * i), &IGMPXRouterExclusionTestCase::SendReport, this);
+      }
+    Simulator::Schedule (Seconds (2), &IGMPXRouterExclusionTestCase::Exclude, this, true, 1u);
+    Simulator::Schedule (Seconds (4), &IGMPXRouterExclusionTestCase::Exclude, this, false, 0u);
+    Simulator::Schedule (Seconds (6), &IGMPXRouterExclusionTestCase::Check, this, 1u);
+    Simulator::Stop (Seconds (10));
+    Simulator::Run ();
+    m_client->Close ();
+    m_client = 0;
+    m_router = 0;
+    Simulator::Destroy ();
+  }
+
+  class IGMPXClientExclusionTestCase : public TestCase
+  {
+    public:
+      IGMPXClientExclusionTestCase ();
+      virtual void
+      DoRun (void);
+
+    private:
+      void
+      Sent (Ptr<const Packet> packet);
+      void
+      Exclude (bool excluded);
+      void
+      Check (uint32_t interface, uint32_t groups);
+
+      Ptr<igmpx::IGMPXRoutingProtocol> m_client;
+      Ipv4Address m_local[3];
+      std::set<Ipv4Address> m_reported[3]; ///< Groups reported per interface since the last change.
+  };
+
+  IGMPXClientExclusionTestCase::IGMPXClientExclusionTestCase () :
+      TestCase("Check that a client is silent on an excluded interface and registers its pairs again once restored")
+  {
+  }
+
+  void
+  IGMPXClientExclusionTestCase::Sent (Ptr<const Packet> packet)
+  {
+    Ptr<Packet> copy = packet->Copy ();
+    Ipv4Header ipHeader;
+    copy->RemoveHeader (ipHeader);
+    uint32_t interface = ipHeader.GetSource () == m_local[1] ? 1 : 2;
+    while (copy->GetSize () > 0)
+      {
+        igmpx::IGMPXHeader message;
+        copy->RemoveHeader (message);
+        if (message.GetType () == igmpx::IGMPX_REPORT)
+          m_reported[interface].insert (message.GetIgmpReportMessage ().m_multicastGroupAddr);
+        else if (message.GetType () == igmpx::IGMPX_REPORT_MULTI)
+          {
+            std::vector<igmpx::IGMPXHeader::IgmpReportMessage> &records = message.GetIgmpMultiReportMessage ().m_records;
+            for (uint32_t i = 0; i < records.size (); i++)
+              {
+                m_reported[interface].insert (records[i].m_multicastGroupAddr);
+              }
+          }
+      }
+  }
+
+  void
+  IGMPXClientExclusionTestCase::Exclude (bool excluded)
+  {
+    std::set<uint32_t> exclusions;
+    if (excluded)
+      exclusions.insert (1);
+    m_client->SetInterfaceExclusions (exclusions);
+    m_reported[1].clear ();
+    m_reported[2].clear ();
+  }
+
+  void
+  IGMPXClientExclusionTestCase::Check (uint32_t interface, uint32_t groups)
+  {
+    NS_TEST_ASSERT_MSG_EQ (m_reported[interface].size (), groups,
+        "Groups reported on interface " << interface << " at " << Simulator::Now ().GetSeconds ());
+  }
+
+  void
+  IGMPXClientExclusionTestCase::DoRun (void)
+  {
+    NodeContainer nodes;
+    nodes.Create (1);
+    BuildIgmpxLan (nodes, 2);
+    m_client = nodes.Get (0)->GetObject<igmpx::IGMPXRoutingProtocol> ();
+    m_client->SetPeerRole (igmpx::CLIENT);
+    for (uint32_t i = 1; i < 3; i++)
+      {
+        m_local[i] = nodes.Get (0)->GetObject<Ipv4> ()->GetAddress (i, 0).GetLocal ();
+      }
+    m_client->TraceConnectWithoutContext ("IgmpxTxControl", MakeCallback (&IGMPXClientExclusionTestCase::Sent, this));
+    // No router answers: the client keeps looking for one with a report every IGMP_TIME.
+    m_client->RegisterInterface (Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 1);
+    m_client->RegisterInterface (Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 2);
+    Simulator::Schedule (Seconds (25), &IGMPXClientExclusionTestCase::Check, this, 1u, 1u);
+    Simulator::Schedule (Seconds (25), &IGMPXClientExclusionTestCase::Exclude, this, true);
+    // A pair registered on the excluded interface waits for the restore.
+    Simulator::Schedule (Seconds (30), &igmpx::IGMPXRoutingProtocol::RegisterInterface, m_client,
+        Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.5"), 1u);
+    Simulator::Schedule (Seconds (60), &IGMPXClientExclusionTestCase::Check, this, 1u, 0u);
+    Simulator::Schedule (Seconds (60), &IGMPXClientExclusionTestCase::Check, this, 2u, 1u);
+    Simulator::Schedule (Seconds (60), &IGMPXClientExclusionTestCase::Exclude, this, false);
+    Simulator::Schedule (Seconds (90), &IGMPXClientExclusionTestCase::Check, this, 1u, 2u);
+    Simulator::Stop (Seconds (90) + MilliSeconds (1));
+    Simulator::Run ();
+    m_client = 0;
+    Simulator::Destroy ();
+  }
+
+  class IGMPXFastLeaveTestCase : public TestCase
+  {
+    public:
+      IGMPXFastLeaveTestCase ();
+      virtual void
+      DoRun (void);
+
+    private:
+      void
+      Received (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+      void
+      Arm ();
+      void
+      Check (uint32_t clients);
+
+      Ptr<igmpx::IGMPXRoutingProtocol> m_router;
+      Ptr<igmpx::IGMPXRoutingProtocol> m_client;
+      bool m_armed; ///< The client is associated: the next query triggers the unregister.
+      bool m_left; ///< The unregister is scheduled.
+  };
+
+  IGMPXFastLeaveTestCase::IGMPXFastLeaveTestCase () :
+      TestCase("Check that a client unregistering with a register pending is dropped by the router on its leave"),
+      m_armed (false), m_left (false)
+  {
+  }
+
+  void
+  IGMPXFastLeaveTestCase::Received (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    if (!m_armed || m_left)
+      return;
+    Ptr<Packet> copy = packet->Copy ();
+    Ipv4Header ipHeader;
+    copy->RemoveHeader (ipHeader);
+    if (ipHeader.GetProtocol () != igmpx::IGMPX_IP_PROTOCOL_NUM)
+      return;
+    bool query = false;
+    while (copy->GetSize () > 0)
+      {
+        igmpx::IGMPXHeader message;
+        copy->RemoveHeader (message);
+        query = query || message.GetType () == igmpx::IGMPX_QUERY;
+      }
+    if (!query)
+      return;
+    // The client answers within the QueryResponseInterval, its register then waits in the queue.
+    m_left = true;
+    Simulator::Schedule (MilliSeconds (500), &igmpx::IGMPXRoutingProtocol::UnregisterInterface, m_client,
+        Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 1u);
+    // The leave leaves with the queue, within the TxQueueWindow of the client.
+    Simulator::Schedule (Seconds (35), &IGMPXFastLeaveTestCase::Check, this, 0u);
+  }
+
+  void
+  IGMPXFastLeaveTestCase::Arm ()
+  {
+    Check (1);
+    m_armed = true;
+  }
+
+  void
+  IGMPXFastLeaveTestCase::Check (uint32_t clients)
+  {
+    NS_TEST_ASSERT_MSG_EQ (m_router->GetClientCount (Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 1), clients,
+        "Clients at " << Simulator::Now ().GetSeconds ());
+  }
+
+  void
+  IGMPXFastLeaveTestCase::DoRun (void)
+  {
+    NodeContainer nodes;
+    nodes.Create (2);
+    BuildIgmpxWifi (nodes);
+    m_router = nodes.Get (0)->GetObject<igmpx::IGMPXRoutingProtocol> ();
+    m_client = nodes.Get (1)->GetObject<igmpx::IGMPXRoutingProtocol> ();
+    m_router->SetPeerRole (igmpx::ROUTER);
+    m_client->SetPeerRole (igmpx::CLIENT);
+    // In query mode the client registers only to answer the queries of the router.
+    m_router->SetAttribute ("QueryMode", BooleanValue (true));
+    m_router->SetAttribute ("QueryInterval", TimeValue (Seconds (10)));
+    m_router->SetAttribute ("QueryResponseInterval", TimeValue (MilliSeconds (100)));
+    m_client->SetAttribute ("QueryMode", BooleanValue (true));
+    // A long window keeps the answers of the client in its queue for a while.
+    m_client->SetAttribute ("TxQueueWindow", TimeValue (Seconds (30)));
+    nodes.Get (1)->GetObject<Ipv4> ()->TraceConnectWithoutContext ("Rx",
+        MakeCallback (&IGMPXFastLeaveTestCase::Received, this));
+    m_client->RegisterInterface (Ipv4Address ("10.0.1.1"), Ipv4Address ("225.1.2.4"), 1);
+    Simulator::Schedule (Seconds (100), &IGMPXFastLeaveTestCase::Arm, this);
+    Simulator::Stop (Seconds (200));
+    Simulator::Run ();
+    NS_TEST_ASSERT_MSG_EQ (m_left, true, "Query heard after the association");
+    m_client = 0;
+    m_router = 0;
+    Simulator::Destroy ();
+  }
+
+  static class IgmpxRoutingTestSuite : public TestSuite
+  {
+    public:
+      IgmpxRoutingTestSuite ();
+  } j_igmpxRoutingTestSuite;
+
+  IgmpxRoutingTestSuite::IgmpxRoutingTestSuite () :
+      TestSuite("igmpx-routing", UNIT)
+  {
+    // RUN $ ./test.py -s igmpx-routing -v -c unit 1
+    AddTestCase(new IGMPXRouterExclusionTestCase());
+    AddTestCase(new IGMPXClientExclusionTestCase());
+    AddTestCase(new IGMPXFastLeaveTestCase());
+  }
+
+} // namespace ns3
@@ -0,0 +1,240 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2011 University of Trento, Italy
+ *                    University of California, Los Angeles, U.S.A.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Alessandro Russo <russo@disi.unitn.it>
+ *          University of Trento, Italy
+ *          University of California, Los Angeles U.S.A.
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/igmpx-timer-wheel.h>
+#include <vector>
+
+namespace ns3
+{
+
+  typedef igmpx::WheelTimer<uint32_t, uint32_t> TestTimer;
+
+  class IGMPXTimerWheelOrderTestCase : public TestCase
+  {
+    public:
+      IGMPXTimerWheelOrderTestCase ();
+      virtual void
+      DoRun (void);
+
+    private:
+      void
+      Fired (uint32_t id, uint32_t unused);
+      void
+      Move (uint32_t id, Time delay);
+      void
+      Cancel (uint32_t id);
+
+      std::vector<TestTimer*> m_timers;
+      std::vector<std::pair<uint32_t, Time> > m_fired;
+  };
+
+  IGMPXTimerWheelOrderTestCase::IGMPXTimerWheelOrderTestCase () :
+      TestCase("Check TimerWheel expiration order, rounding, moves and cancels")
+  {
+  }
+
+  void
+  IGMPXTimerWheelOrderTestCase::Fired (uint32_t id, uint32_t unused)
+  {
+    m_fired.push_back(std::make_pair(id, Simulator::Now()));
+  }
+
+  void
+  IGMPXTimerWheelOrderTestCase::Move (uint32_t id, Time delay)
+  {
+    NS_TEST_ASSERT_MSG_EQ (m_timers[id]->IsRunning (), true, "Running before the move");
+    m_timers[id]->Schedule (delay);
+  }
+
+  void
+  IGMPXTimerWheelOrderTestCase::Cancel (uint32_t id)
+  {
+    m_timers[id]->Cancel ();
+    NS_TEST_ASSERT_MSG_EQ (m_timers[id]->IsRunning (), false, "Cancelled");
+  }
+
+  void
+  IGMPXTimerWheelOrderTestCase::DoRun (void)
+  {
+    {
+      igmpx::TimerWheel wheel;
+      wheel.SetResolution (MilliSeconds (10));
+      // 15ms rounds up to the next tick; 3s, 200s and 12000s start in levels 1, 2 and 3;
+      // ten days is beyond the wheel span and stays parked in the last level for a while.
+      Time delays[] = { MilliSeconds (15), Seconds (1), Seconds (3), Seconds (200), Seconds (12000), Seconds (864000),
+          Seconds (5), Seconds (2), Seconds (4) };
+      for (uint32_t i = 0; i < 9; i++)
+        {
+          TestTimer *timer = new TestTimer (&wheel);
+          timer->SetFunction (&IGMPXTimerWheelOrderTestCase::Fired, this);
+          timer->SetArguments (i, 0);
+          timer->Schedule (delays[i]);
+          m_timers.push_back (timer);
+        }
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetSize (), 9u, "Size");
+      NS_TEST_ASSERT_MSG_EQ (m_timers[1]->GetDelayLeft (), Seconds (1), "Delay left");
+      // A running timer moves earlier without a Cancel, another one moves later and the last one is cancelled.
+      m_timers[6]->Schedule (MilliSeconds (500));
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetSize (), 9u, "Size after the move");
+      Simulator::Schedule (Seconds (0.5), &IGMPXTimerWheelOrderTestCase::Move, this, 7u, Seconds (2));
+      Simulator::Schedule (Seconds (1), &IGMPXTimerWheelOrderTestCase::Cancel, this, 8u);
+      Simulator::Run ();
+
+      uint32_t ids[] = { 0, 6, 1, 7, 2, 3, 4, 5 };
+      Time times[] = { MilliSeconds (20), MilliSeconds (500), Seconds (1), Seconds (2.5), Seconds (3), Seconds (200),
+          Seconds (12000), Seconds (864000) };
+      NS_TEST_ASSERT_MSG_EQ (m_fired.size (), 8u, "Expired timers");
+      for (uint32_t i = 0; i < m_fired.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (m_fired[i].first, ids[i], "Expiration order");
+          NS_TEST_ASSERT_MSG_EQ (m_fired[i].second, times[i], "Expiration time");
+        }
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetSize (), 0u, "Empty wheel");
+      for (uint32_t i = 0; i < m_timers.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (m_timers[i]->IsRunning (), false, "Not running");
+          delete m_timers[i];
+        }
+      m_timers.clear ();
+    }
+    Simulator::Destroy ();
+  }
+
+  class IGMPXTimerWheelCallbackTestCase : public TestCase
+  {
+    public:
+      IGMPXTimerWheelCallbackTestCase ();
+      virtual void
+      DoRun (void);
+
+    private:
+      void
+      Again (uint32_t id, uint32_t count);
+      void
+      Destroy (uint32_t id, uint32_t unused);
+
+      std::vector<TestTimer*> m_timers;
+      std::vector<std::pair<uint32_t, Time> > m_fired;
+  };
+
+  IGMPXTimerWheelCallbackTestCase::IGMPXTimerWheelCallbackTestCase () :
+      TestCase("Check TimerWheel timers scheduled or destroyed by their own callback")
+  {
+  }
+
+  void
+  IGMPXTimerWheelCallbackTestCase::Again (uint32_t id, uint32_t count)
+  {
+    m_fired.push_back (std::make_pair (id, Simulator::Now ()));
+    if (count == 0)
+      return;
+    // Timer 0 comes back in the tick being processed, timer 1 one second later.
+    m_timers[id]->SetArguments (id, count - 1);
+    m_timers[id]->Schedule (id == 0 ? Seconds (0) : Seconds (1));
+  }
+
+  void
+  IGMPXTimerWheelCallbackTestCase::Destroy (uint32_t id, uint32_t unused)
+  {
+    m_fired.push_back (std::make_pair (id, Simulator::Now ()));
+    // Timers 2 and 3 expire in the same tick: the first one destroys both.
+    for (uint32_t i = 2; i < 4; i++)
+      {
+        delete m_timers[i];
+        m_timers[i] = 0;
+      }
+  }
+
+  void
+  IGMPXTimerWheelCallbackTestCase::DoRun (void)
+  {
+    {
+      igmpx::TimerWheel wheel;
+      wheel.SetResolution (MilliSeconds (10));
+      for (uint32_t i = 0; i < 4; i++)
+        {
+          TestTimer *timer = new TestTimer (&wheel);
+          if (i < 2)
+            {
+              timer->SetFunction (&IGMPXTimerWheelCallbackTestCase::Again, this);
+              timer->SetArguments (i, 2);
+            }
+          else
+            {
+              timer->SetFunction (&IGMPXTimerWheelCallbackTestCase::Destroy, this);
+              timer->SetArguments (i, 0);
+            }
+          m_timers.push_back (timer);
+        }
+      m_timers[0]->Schedule (Seconds (1));
+      m_timers[1]->Schedule (Seconds (1));
+      m_timers[2]->Schedule (Seconds (5));
+      m_timers[3]->Schedule (Seconds (5));
+      Simulator::Run ();
+
+      uint32_t again[] = { 0, 0 };
+      uint32_t destroyed = 0;
+      for (uint32_t i = 0; i < m_fired.size (); i++)
+        {
+          uint32_t id = m_fired[i].first;
+          if (id == 0)
+            NS_TEST_ASSERT_MSG_EQ (m_fired[i].second, Seconds (1), "Rescheduled in the same tick");
+          else if (id == 1)
+            NS_TEST_ASSERT_MSG_EQ (m_fired[i].second, Seconds (1 + again[1]), "Rescheduled one second later");
+          else
+            NS_TEST_ASSERT_MSG_EQ (m_fired[i].second, Seconds (5), "Destroyed in the callback");
+          if (id < 2)
+            again[id]++;
+          else
+            destroyed++;
+        }
+      NS_TEST_ASSERT_MSG_EQ (again[0], 3u, "Expirations of the timer rescheduled with no delay");
+      NS_TEST_ASSERT_MSG_EQ (again[1], 3u, "Expirations of the timer rescheduled later");
+      NS_TEST_ASSERT_MSG_EQ (destroyed, 1u, "The destroyed timer does not expire");
+      NS_TEST_ASSERT_MSG_EQ (wheel.GetSize (), 0u, "Empty wheel");
+      for (uint32_t i = 0; i < m_timers.size (); i++)
+        {
+          delete m_timers[i];
+        }
+      m_timers.clear ();
+    }
+    Simulator::Destroy ();
+  }
+
+  static class IgmpxTimerWheelTestSuite : public TestSuite
+  {
+    public:
+      IgmpxTimerWheelTestSuite ();
+  } j_igmpxTimerWheelTestSuite;
+
+  IgmpxTimerWheelTestSuite::IgmpxTimerWheelTestSuite () :
+      TestSuite("igmpx-timer-wheel", UNIT)
+  {
+    // RUN $ ./test.py -s igmpx-timer-wheel -v -c unit 1
+    AddTestCase(new IGMPXTimerWheelOrderTestCase());
+    AddTestCase(new IGMPXTimerWheelCallbackTestCase());
+  }
+
+} // namespace ns3